@@ -15,16 +15,44 @@
  *    if x < 0 then the state is obtained from the system clock
  *    if x = 0 then the state is to be supplied interactively.
  *
+ * Each stream is an rng_t object that can also be used directly, without
+ * the global stream selection: rng_random(r) draws from r, rng_jump(r, n)
+ * advances r by n draws in O(log n) and rng_stream(r, x, s, k) places r
+ * at substream k of stream s of the seed x, for any s and k.  Stream s
+ * starts s * RNG_STREAM_JUMP states after x and substream k another
+ * k * RNG_SUBSTREAM_JUMP states later, so substream 0 of the first 256
+ * streams are the streams planted by PlantSeeds(x), and substream
+ * r * REPLICATION_STREAMS + j of stream 0 is stream j of
+ * PlantReplicationSeeds(x, r).  All jumps are taken modulo the period:
+ * beyond 2^11 substreams or 256 streams the sequences eventually overlap
+ * others.
+ *
  * The generator used in this library is a so-called 'Lehmer random number
  * generator' which returns a pseudo-random number uniformly distributed
  * 0.0 and 1.0.  The period is (m - 1) where m = 2,147,483,647 and the
  * smallest and largest possible values are (1 / m) and 1 - (1 / m)
- * respectively.  For more details see:
+ * respectively.  Each stream computes its next RNG_BLOCK states at once,
+ * x * a^i mod m for i = 1, ..., RNG_BLOCK, with AVX-512 or AVX2 when the
+ * processor has them (compile with -DRNG_SIMD=0 to disable); the states
+ * are exact integers, so the sequences are the same as one at a time.  For more details see:
  * 
  *       "Random Number Generators: Good Ones Are Hard To Find"
  *                   Steve Park and Keith Miller
  *              Communications of the ACM, October 1988
  *
+ * Compiled with -DRNG_PHILOX=1 (make philox) the library uses instead the
+ * counter-based generator Philox4x32-10 behind the same interface:
+ *
+ *       "Parallel Random Numbers: As Easy as 1, 2, 3"
+ *         J. Salmon, M. Moraes, R. Dror and D. Shaw, SC 2011
+ *
+ * The n-th output of a stream is a pure function of its 64-bit key (the
+ * seed x and the stream index) and of a 128-bit counter (the substream in
+ * the high half, n / 4 in the low half), so any stream, substream and
+ * position is reached in O(1) and every substream holds 2^66 outputs.
+ * Outputs are 32-bit, mapped to (0.0, 1.0) as (u + 0.5) / 2^32; stream j
+ * of PlantReplicationSeeds(x, r) is substream r of stream j of x.
+ *
  * Name            : rngs.c  (Random Number Generation - Multiple Streams)
  * Authors         : Steve Park & Dave Geyer
  * Language        : ANSI C
@@ -32,20 +60,303 @@
  * ------------------------------------------------------------------------- 
  */
 
+#include <stdint.h>
 #include <stdio.h>
 #include <time.h>
 #include "rngs.h"
 
+#if !defined(RNG_SIMD) && defined(__GNUC__) && defined(__x86_64__)
+#define RNG_SIMD 1
+#endif
+#if RNG_SIMD && !RNG_PHILOX
+#include <immintrin.h>
+#endif
+
 #define MODULUS    2147483647 /* DON'T CHANGE THIS VALUE                  */
 #define MULTIPLIER 48271      /* DON'T CHANGE THIS VALUE                  */
 #define CHECK      399268537  /* DON'T CHANGE THIS VALUE                  */
-#define STREAMS    256        /* # of streams, DON'T CHANGE THIS VALUE    */
 #define A256       22925      /* jump multiplier, DON'T CHANGE THIS VALUE */
 #define DEFAULT    123456789  /* initial seed, use 0 < DEFAULT < MODULUS  */
       
-static long seed[STREAMS] = {DEFAULT};  /* current state of each stream   */
-static int  stream        = 0;          /* stream index, 0 is the default */
-static int  initialized   = 0;          /* test for stream initialization */
+#if RNG_PHILOX
+static rngs_state               default_state = {.seed = {{.key = {DEFAULT}}}, .stream = 0, .initialized = 0};
+#else
+static rngs_state               default_state = {.seed = {{.x = DEFAULT}}, .stream = 0, .initialized = 0};
+#endif
+static _Thread_local rngs_state *state         = &default_state;  /* in use by this thread */
+
+
+#if RNG_PHILOX
+
+#define PHILOX_M0  0xD2511F53u  /* round multipliers  */
+#define PHILOX_M1  0xCD9E8D57u
+#define PHILOX_W0  0x9E3779B9u  /* key schedule (Weyl) */
+#define PHILOX_W1  0xBB67AE85u
+
+
+   static void PhiloxBlock(unsigned long long block, const uint32_t high[2], const uint32_t key[2], uint32_t out[4])
+/* ---------------------------------------------------------------
+ * Computes the 4 outputs of Philox4x32-10 for the counter made of
+ * block (low 64 bits) and high (substream) with the given key.
+ * ---------------------------------------------------------------
+ */
+{
+  uint32_t c[4] = {(uint32_t) block, (uint32_t) (block >> 32), high[0], high[1]};
+  uint32_t k0   = key[0];
+  uint32_t k1   = key[1];
+  int      i;
+
+  for (i = 0; i < 10; i++) {
+    uint64_t p0 = (uint64_t) PHILOX_M0 * c[0];
+    uint64_t p1 = (uint64_t) PHILOX_M1 * c[2];
+    c[0] = (uint32_t) (p1 >> 32) ^ c[1] ^ k0;
+    c[1] = (uint32_t) p1;
+    c[2] = (uint32_t) (p0 >> 32) ^ c[3] ^ k1;
+    c[3] = (uint32_t) p0;
+    k0  += PHILOX_W0;
+    k1  += PHILOX_W1;
+  }
+  for (i = 0; i < 4; i++)
+    out[i] = c[i];
+}
+
+
+   double rng_random(rng_t *r)
+/* ----------------------------------------------------------------
+ * rng_random advances the stream r and returns a pseudo-random real
+ * number uniformly distributed between 0.0 and 1.0.
+ * ----------------------------------------------------------------
+ */
+{
+  if (r->avail == 0) {
+    PhiloxBlock(r->block++, r->high, r->key, r->out);
+    r->avail = 4;
+  }
+  return ((r->out[4 - r->avail--] + 0.5) / 4294967296.0);
+}
+
+
+   void rng_jump(rng_t *r, unsigned long long n)
+/* ---------------------------------------------------------------
+ * Advances the stream r by n calls to rng_random in O(1).
+ * ---------------------------------------------------------------
+ */
+{
+  unsigned long long block = r->block - (r->avail > 0);   /* block of the next output */
+  unsigned long long index = (4 - r->avail) % 4 + n % 4;  /* its position in the block */
+
+  block += n / 4 + index / 4;
+  index %= 4;
+  r->block = block;
+  r->avail = 0;
+  if (index > 0) {
+    PhiloxBlock(r->block++, r->high, r->key, r->out);
+    r->avail = 4 - (int) index;
+  }
+}
+
+
+   void rng_stream(rng_t *r, long x, unsigned long long stream, unsigned long long substream)
+/* ---------------------------------------------------------------
+ * Sets r to the first output of substream 'substream' of stream
+ * 'stream' of the seed x: the key is (x, stream), the high half of
+ * the counter is the substream.  Only the low 32 bits of stream
+ * are used.
+ * ---------------------------------------------------------------
+ */
+{
+  r->key[0]  = (uint32_t) x;
+  r->key[1]  = (uint32_t) stream;
+  r->high[0] = (uint32_t) substream;
+  r->high[1] = (uint32_t) (substream >> 32);
+  r->block   = 0;
+  r->avail   = 0;
+}
+
+
+   unsigned long long rng_draws(rng_t *r)
+/* ---------------------------------------------------------------
+ * Returns the position of r in its substream: the calls to
+ * rng_random, and the draws skipped by rng_jump, since rng_stream.
+ * ---------------------------------------------------------------
+ */
+{
+  return (4 * r->block - r->avail);
+}
+
+#else
+
+static const uint32_t POWERS[RNG_BLOCK] = {  /* MULTIPLIER^i mod MODULUS, i = 1, 2, ... */
+       48271,  182605794, 1291394886, 1914720637, 2078669041,  407355683,
+  1105902161,  854716505,  564586691, 1596680831,  192302371, 1203428207,
+  1250328747, 1738531149, 1271135913, 1098894339, 1882556969, 2136927794,
+  1559527823, 2075782095,  638022372,  914937185, 1931656580, 1402304087,
+  1936030137, 2064876628,  353718330, 1842513780, 1947433875,  631416347,
+  2010567813,  890442452,  662405787, 1105724094,  849178936, 1696049367,
+  1479919876, 1168816941, 1272185027,  201068705, 1308858262,  928270262,
+  1287522347, 1814467857, 1057382352, 1659675143,  153892771,  412013968,
+   480194461, 1675824860,  180318217,  389431516, 1324346645, 1243696899,
+  1587659744,  674592135,  942409124,  884730203, 1951824771, 2130959757,
+  1239222494,  352020689, 1500063655,  719080959};
+
+
+   static void FillScalar(long x, long ahead[])
+/* ---------------------------------------------------------------
+ * ahead[i] = x * MULTIPLIER^(i + 1) mod MODULUS.  The product has
+ * at most 62 bits and MODULUS = 2^31 - 1, so p mod MODULUS is
+ * (p & MODULUS) + (p >> 31), less MODULUS once if too large.
+ * ---------------------------------------------------------------
+ */
+{
+  int i;
+
+  for (i = 0; i < RNG_BLOCK; i++) {
+    uint64_t p = (uint64_t) x * POWERS[i];
+    p = (p & MODULUS) + (p >> 31);
+    ahead[i] = (long) (p >= MODULUS ? p - MODULUS : p);
+  }
+}
+
+#if RNG_SIMD
+
+   __attribute__((target("avx2"))) static void FillAVX2(long x, long ahead[])
+/* ---------------------------------------------------------------
+ * FillScalar on 4 states at a time.
+ * ---------------------------------------------------------------
+ */
+{
+  const __m256i vx = _mm256_set1_epi64x(x);
+  const __m256i m  = _mm256_set1_epi64x(MODULUS);
+  const __m256i m1 = _mm256_set1_epi64x(MODULUS - 1);
+  int           i;
+
+  for (i = 0; i < RNG_BLOCK; i += 4) {
+    __m256i a = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *) &POWERS[i]));
+    __m256i p = _mm256_mul_epu32(vx, a);
+    p = _mm256_add_epi64(_mm256_and_si256(p, m), _mm256_srli_epi64(p, 31));
+    p = _mm256_sub_epi64(p, _mm256_and_si256(_mm256_cmpgt_epi64(p, m1), m));
+    _mm256_storeu_si256((__m256i *) &ahead[i], p);
+  }
+}
+
+
+   __attribute__((target("avx512f"))) static void FillAVX512(long x, long ahead[])
+/* ---------------------------------------------------------------
+ * FillScalar on 8 states at a time.
+ * ---------------------------------------------------------------
+ */
+{
+  const __m512i vx = _mm512_set1_epi64(x);
+  const __m512i m  = _mm512_set1_epi64(MODULUS);
+  int           i;
+
+  for (i = 0; i < RNG_BLOCK; i += 8) {
+    __m512i a = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *) &POWERS[i]));
+    __m512i p = _mm512_mul_epu32(vx, a);
+    p = _mm512_add_epi64(_mm512_and_si512(p, m), _mm512_srli_epi64(p, 31));
+    p = _mm512_mask_sub_epi64(p, _mm512_cmpge_epu64_mask(p, m), p, m);
+    _mm512_storeu_si512((void *) &ahead[i], p);
+  }
+}
+
+#endif
+
+
+   double rng_random(rng_t *r)
+/* ----------------------------------------------------------------
+ * rng_random advances the stream r and returns a pseudo-random real
+ * number uniformly distributed between 0.0 and 1.0.
+ * ----------------------------------------------------------------
+ */
+{
+  if (r->avail == 0) {
+#if RNG_SIMD
+    if (__builtin_cpu_supports("avx512f"))
+      FillAVX512(r->x, r->ahead);
+    else if (__builtin_cpu_supports("avx2"))
+      FillAVX2(r->x, r->ahead);
+    else
+#endif
+      FillScalar(r->x, r->ahead);
+    r->avail  = RNG_BLOCK;
+    r->drawn += RNG_BLOCK;
+  }
+  r->x = r->ahead[RNG_BLOCK - r->avail--];
+  return ((double) r->x / MODULUS);
+}
+
+
+   static long MultiplyMod(long a, long b)
+/* ---------------------------------------------------------------
+ * Returns (a * b) mod MODULUS, a and b in [0, MODULUS).
+ * ---------------------------------------------------------------
+ */
+{
+  return (long) (((unsigned long long) a * (unsigned long long) b) % MODULUS);
+}
+
+
+   static long JumpMultiplier(unsigned long n)
+/* ---------------------------------------------------------------
+ * Returns MULTIPLIER^n mod MODULUS: multiplying a state by this
+ * value is the same as calling Random() n times.
+ * ---------------------------------------------------------------
+ */
+{
+  long result = 1;
+  long power  = MULTIPLIER;
+
+  while (n > 0) {
+    if (n & 1)
+      result = MultiplyMod(result, power);
+    power = MultiplyMod(power, power);
+    n >>= 1;
+  }
+  return (result);
+}
+
+
+   void rng_jump(rng_t *r, unsigned long long n)
+/* ---------------------------------------------------------------
+ * Advances the stream r by n calls to rng_random, n taken modulo
+ * the period (MODULUS - 1).
+ * ---------------------------------------------------------------
+ */
+{
+  r->x      = MultiplyMod(r->x, JumpMultiplier((unsigned long) (n % (MODULUS - 1))));
+  r->drawn  = r->drawn - r->avail + n;
+  r->avail  = 0;
+}
+
+
+   void rng_stream(rng_t *r, long x, unsigned long long stream, unsigned long long substream)
+/* ---------------------------------------------------------------
+ * Sets r to the first state of substream 'substream' of stream
+ * 'stream' of the seed x, 0 < x < MODULUS (see the layout at the
+ * top of this file).  The state depends only on its arguments.
+ * ---------------------------------------------------------------
+ */
+{
+  r->x = x;
+  rng_jump(r, (stream % (MODULUS - 1)) * RNG_STREAM_JUMP);
+  rng_jump(r, (substream % (MODULUS - 1)) * RNG_SUBSTREAM_JUMP);
+  r->drawn = 0;
+}
+
+
+   unsigned long long rng_draws(rng_t *r)
+/* ---------------------------------------------------------------
+ * Returns the position of r in its stream: the calls to
+ * rng_random, and the draws skipped by rng_jump, since r was placed
+ * by rng_stream or PlantSeeds.
+ * ---------------------------------------------------------------
+ */
+{
+  return (r->drawn - r->avail);
+}
+
+
+#endif
 
 
    double Random(void)
@@ -55,16 +366,7 @@ static int  initialized   = 0;          /* test for stream initialization */
  * ----------------------------------------------------------------
  */
 {
-  const long Q = MODULUS / MULTIPLIER;
-  const long R = MODULUS % MULTIPLIER;
-        long t;
-
-  t = MULTIPLIER * (seed[stream] % Q) - R * (seed[stream] / Q);
-  if (t > 0) 
-    seed[stream] = t;
-  else 
-    seed[stream] = t + MODULUS;
-  return ((double) seed[stream] / MODULUS);
+  return (rng_random(&state->seed[state->stream]));
 }
 
 
@@ -74,27 +376,101 @@ static int  initialized   = 0;          /* test for stream initialization */
  * streams by "planting" a sequence of states (seeds), one per stream, 
  * with all states dictated by the state of the default stream. 
  * The sequence of planted states is separated one from the next by 
- * 8,367,782 calls to Random().
+ * 8,367,782 calls to Random().  With Philox stream j is keyed by (x, j).
  * ---------------------------------------------------------------------
  */
 {
+#if !RNG_PHILOX
   const long Q = MODULUS / A256;
   const long R = MODULUS % A256;
+#endif
         int  j;
         int  s;
 
-  initialized = 1;
-  s = stream;                            /* remember the current stream */
+  state->initialized = 1;
+  s = state->stream;                     /* remember the current stream */
   SelectStream(0);                       /* change to stream 0          */
   PutSeed(x);                            /* set seed[0]                 */
-  stream = s;                            /* reset the current stream    */
+  state->stream = s;                     /* reset the current stream    */
+#if RNG_PHILOX
+  x = state->seed[0].key[0];
+  for (j = 1; j < STREAMS; j++)
+    rng_stream(&state->seed[j], x, j, 0);
+#else
   for (j = 1; j < STREAMS; j++) {
-    x = A256 * (seed[j - 1] % Q) - R * (seed[j - 1] / Q);
+    x = A256 * (state->seed[j - 1].x % Q) - R * (state->seed[j - 1].x / Q);
     if (x > 0)
-      seed[j] = x;
+      state->seed[j].x = x;
     else
-      seed[j] = x + MODULUS;
+      state->seed[j].x = x + MODULUS;
+    state->seed[j].avail = 0;
+    state->seed[j].drawn = 0;
    }
+#endif
+}
+
+
+   void PlantReplicationSeeds(long x, int r)
+/* ---------------------------------------------------------------------
+ * Use this function to set the state of the first REPLICATION_STREAMS
+ * streams for the r-th of REPLICATIONS independent replications,
+ * 0 <= r < REPLICATIONS.  Starting from x, the period is split in
+ * REPLICATIONS consecutive slices of 2^23 states, one per replication;
+ * inside its slice each stream starts 2^20 states after the previous
+ * one, i.e. stream j is substream r * REPLICATION_STREAMS + j of stream
+ * 0 of x.  The whole period cannot hold 2^20 states for all 256 streams
+ * of 128 replications: the other streams keep the states planted by
+ * PlantSeeds(x), shared by all the replications, and must not be used.
+ * A stream that uses more than 1,048,576 calls to Random() overlaps
+ * the next one: ReplicationOverlap tells when either happened.
+ * With Philox stream j is substream r of stream j of x, for all the
+ * streams, and holds 2^66 outputs.
+ * The planted states depend only on x and r, so the replications can
+ * run in any order and on any thread.
+ * ---------------------------------------------------------------------
+ */
+{
+  int j;
+
+  PlantSeeds(x);                         /* validate x as seed[0]       */
+#if RNG_PHILOX
+  x = state->seed[0].key[0];
+  for (j = 0; j < STREAMS; j++)
+    rng_stream(&state->seed[j], x, j, (unsigned long long) r);
+#else
+  x = state->seed[0].x;
+  for (j = 0; j < REPLICATION_STREAMS; j++)
+    rng_stream(&state->seed[j], x, 0, (unsigned long long) r * REPLICATION_STREAMS + j);
+#endif
+}
+
+
+   int ReplicationOverlap(rngs_state *s, unsigned long long *draws)
+/* ---------------------------------------------------------------------
+ * Use this function after a replication planted by PlantReplicationSeeds
+ * to check that no stream of s has run past its slice of RNG_SUBSTREAM_JUMP
+ * states into the next one, and that no stream beyond the first
+ * REPLICATION_STREAMS has been used.  Returns the first such stream, with
+ * its number of draws in *draws, or -1 if the streams are still disjoint.
+ * With Philox it always returns -1.
+ * ---------------------------------------------------------------------
+ */
+{
+  int j;
+  int over = -1;
+
+  *draws = 0;
+#if !RNG_PHILOX
+  for (j = 0; j < STREAMS && over < 0; j++)
+    if (rng_draws(&s->seed[j]) > ((j < REPLICATION_STREAMS) ? RNG_SUBSTREAM_JUMP : 0)) {
+      over   = j;
+      *draws = rng_draws(&s->seed[j]);
+    }
+#else
+  (void) s;
+  (void) j;
+#endif
+  return (over);
 }
 
 
@@ -122,18 +498,23 @@ static int  initialized   = 0;          /* test for stream initialization */
       if (!ok)
         printf("\nInput out of range ... try again\n");
     }
-  seed[stream] = x;
+  rng_stream(&state->seed[state->stream], x, 0, 0);
 }
 
 
    void GetSeed(long *x)
 /* ---------------------------------------------------------------
  * Use this function to get the state of the current random number 
- * generator stream.                                                   
+ * generator stream.  With Philox, whose state is not a single long,
+ * it returns the seed the stream was planted with.
  * ---------------------------------------------------------------
  */
 {
-  *x = seed[stream];
+#if RNG_PHILOX
+  *x = state->seed[state->stream].key[0];
+#else
+  *x = state->seed[state->stream].x;
+#endif
 }
 
 
@@ -144,9 +525,22 @@ static int  initialized   = 0;          /* test for stream initialization */
  * ------------------------------------------------------------------
  */
 {
-  stream = ((unsigned int) index) % STREAMS;
-  if ((initialized == 0) && (stream != 0))   /* protect against        */
-    PlantSeeds(DEFAULT);                     /* un-initialized streams */
+  state->stream = ((unsigned int) index) % STREAMS;
+  if ((state->initialized == 0) && (state->stream != 0))  /* protect against        */
+    PlantSeeds(DEFAULT);                                  /* un-initialized streams */
+}
+
+
+   void SelectState(rngs_state *s)
+/* ------------------------------------------------------------------
+ * Use this function to make s the state used by all the other
+ * functions of the library, so that independent simulations can keep
+ * their own set of streams.  The default state is used until the first
+ * call.
+ * ------------------------------------------------------------------
+ */
+{
+  state = s;
 }
 
 
@@ -156,10 +550,54 @@ static int  initialized   = 0;          /* test for stream initialization */
  * ------------------------------------------------------------------    
  */
 {
+#if RNG_PHILOX
+  static const uint32_t counters[3][4] = {{0, 0, 0, 0},             /* known answers of   */
+                                          {0xffffffff, 0xffffffff,  /* Philox4x32-10 from */
+                                           0xffffffff, 0xffffffff}, /* Random123          */
+                                          {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+  static const uint32_t keys[3][2]     = {{0, 0}, {0xffffffff, 0xffffffff}, {0xa4093822, 0x299f31d0}};
+  static const uint32_t answers[3][4]  = {{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+                                          {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+                                          {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+  uint32_t out[4];
+  long     i;
+  long     j;
+  double   u;
+  char     ok = 1;
+  rng_t    r;
+  rng_t    q;
+
+  for (i = 0; i < 3; i++) {
+    PhiloxBlock(((unsigned long long) counters[i][1] << 32) | counters[i][0], &counters[i][2], keys[i], out);
+    for (j = 0; j < 4; j++)
+      ok = ok && (out[j] == answers[i][j]);
+  }
+
+  rng_stream(&r, 1, 5, 7);          /* jumping ahead, also from the middle */
+  for (i = 0; i < 10001; i++)       /* of a block, matches the draws       */
+    u = rng_random(&r);
+  rng_stream(&q, 1, 5, 7);
+  rng_jump(&q, 10000);
+  ok = ok && (rng_random(&q) == u);
+  rng_stream(&q, 1, 5, 7);
+  for (i = 0; i < 3; i++)
+    rng_random(&q);
+  rng_jump(&q, 9997);
+  ok = ok && (rng_random(&q) == u);
+  ok = ok && (rng_draws(&q) == 10001) && (rng_draws(&r) == 10001);
+
+  PlantReplicationSeeds(1, REPLICATIONS - 1);
+  for (j = 0; j < STREAMS; j++) {   /* stream j of replication r is substream r of stream j */
+    rng_stream(&r, 1, j, REPLICATIONS - 1);
+    ok = ok && (rng_random(&r) == rng_random(&state->seed[j]));
+  }
+#else
   long   i;
+  long   j;
   long   x;
   double u;
   char   ok = 0;  
+  rng_t  r;
 
   SelectStream(0);                  /* select the default stream */
   PutSeed(1);                       /* and set the state to 1    */
@@ -167,11 +605,26 @@ static int  initialized   = 0;          /* test for stream initialization */
     u = Random();
   GetSeed(&x);                      /* get the new state value   */
   ok = (x == CHECK);                /* and check for correctness */
+  ok = ok && (rng_draws(&state->seed[0]) == 10000);
 
   SelectStream(1);                  /* select stream 1                 */ 
   PlantSeeds(1);                    /* set the state of all streams    */
   GetSeed(&x);                      /* get the state of stream 1       */
   ok = ok && (x == A256);           /* x should be the jump multiplier */    
+
+  rng_stream(&r, 1, 0, 0);          /* jumping ahead 10000 states      */
+  rng_jump(&r, 10000);              /* matches 10000 calls to Random() */
+  ok = ok && (r.x == CHECK) && (rng_draws(&r) == 10000);
+  for (j = 0; j < STREAMS; j++) {   /* rng_stream reproduces the streams of */
+    rng_stream(&r, 1, j, 0);        /* PlantSeeds and PlantReplicationSeeds */
+    ok = ok && (r.x == state->seed[j].x);
+  }
+  PlantReplicationSeeds(1, REPLICATIONS - 1);
+  for (j = 0; j < REPLICATION_STREAMS; j++) {
+    rng_stream(&r, 1, 0, (REPLICATIONS - 1) * REPLICATION_STREAMS + j);
+    ok = ok && (r.x == state->seed[j].x);
+  }
+#endif
   if (ok)
     printf("\n The implementation of rngs.c is correct.\n\n");
   else
@@ -1,8 +1,14 @@
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "./DES/rngs.h"
 
 #define NUM_BLOCKS 5
 
 #define MAX_SERVERS 50
+#define IDLE_WORDS ((MAX_SERVERS + 63) / 64)  // Parole a 64 bit della bitmap dei server liberi di un blocco
 
 #define START 0.0
 #define DEBUG true
@@ -17,7 +23,9 @@
 #define NOTUSED 0
 
 #define NUM_REPETITIONS 128
+_Static_assert(NUM_REPETITIONS <= REPLICATIONS, "ogni replica deve avere i propri stream disgiunti");
 
+// Valori predefiniti dei parametri del modello, sostituibili all'avvio da file di configurazione (-c) o da riga di comando (-s)
 // Input Values
 #define LAMBDA_1 0.405556
 #define LAMBDA_2 0.829545
@@ -27,6 +35,7 @@
 #define TIME_SLOT_1 10800
 #define TIME_SLOT_2 39600
 #define TIME_SLOT_3 18000
+#define DAYS_IN_MONTH 30  // Giornate su cui si ripartisce il costo mensile di un server, ognuna lunga quanto le tre fasce
 
 // Services Time
 #define SERV_TEMPERATURE_CTRL 15  //u = 0.06666667
@@ -47,10 +56,55 @@
 #define CM_TICKET_GATE_SERVER 1300
 #define CM_GREEN_PASS_SERVER 800
 
-// Numero di ripetizioni e batch
+// Numero di ripetizioni e batch, valori predefiniti delle chiavi di [run]. NUM_REPETITIONS e BATCH_K sono anche i massimi
+// accettati da run.repetitions e run.batch_k
 #define NUM_REPETITIONS 128
-#define BATCH_B 1024
+#define BATCH_B 1024       // Dimensione fissa delle batch nella valutazione dei candidati (SEARCH)
+#define BATCH_B_MIN 1024   // Dimensione iniziale delle batch ad orizzonte infinito, raddoppiata finché serve. Ogni batch parte
+                           // dal sistema vuoto, sotto questa dimensione peserebbe il transitorio iniziale
+#define BATCH_B_MAX 16384  // Oltre questa dimensione le batch vengono accettate anche se ancora correlate
+#define BATCH_ACF 0.2      // Autocorrelazione di lag 1 delle batch means sotto cui le batch si considerano indipendenti
 #define BATCH_K 128
+#define MIN_REPETITIONS 10  // Repliche minime prima di applicare la regola di arresto sequenziale (-p)
+#define CONFIDENCE 0.95     // Livello di confidenza degli intervalli sul tempo di risposta
+#define ACS_LAGS 8          // Lag massimo delle autocorrelazioni riportate nei riepiloghi (K di DES/acs.c)
+#define MSER_BATCH 5      // Osservazioni raggruppate in ogni media della regola MSER (MSER-5)
+#define MSER_PILOT 32768  // Arrivi della run pilota su cui si cerca la fine del transitorio iniziale
+// I serventi di un blocco estraggono i tempi di servizio dallo stream con l'indice del blocco
+#define STATIONARY_STREAM NUM_BLOCKS     // Stream delle popolazioni iniziali estratte dalla distribuzione stazionaria (-i STATIONARY)
+#define ARRIVAL_STREAM (NUM_BLOCKS + 1)  // Stream degli interarrivi dall'esterno
+_Static_assert(ARRIVAL_STREAM < REPLICATION_STREAMS, "PlantReplicationSeeds rende disgiunti solo i primi REPLICATION_STREAMS stream");
+#define ESTIMATOR_BM 0   // Stimatori della varianza ad orizzonte infinito (-e): batch means non sovrapposte,
+#define ESTIMATOR_OBM 1  // overlapping batch means
+#define ESTIMATOR_STS 2  // area delle serie temporali standardizzate
+#define ESTIMATOR_REG 3  // e metodo rigenerativo sui cicli che iniziano con un arrivo a rete vuota
+#define REG_MIN_CYCLES 30  // Cicli rigenerativi attesi sotto i quali -e REG viene rifiutato prima di simulare
+#define SEED_FINITE 231232132    // Seed delle simulazioni ad orizzonte finito e del confronto (COMPARE)
+#define SEED_INFINITE 231232132  // Seed delle simulazioni ad orizzonte infinito, della ricerca e della soluzione analitica
+#define OUTPUT_DIR "results"      // Cartella dei risultati, con le sottocartelle finite e infinite
+#define PATH_LENGTH 256            // Lunghezza massima dei percorsi dei file di configurazione e dei risultati
+#define ALL_SLOTS -1  // Slot passato da riga di comando come ALL: i tre slot ad orizzonte infinito in parallelo
+
+// Vincoli di QoS della ricerca della configurazione ottima (modalità SEARCH)
+#define QOS_RESPONSE_TIME 120   // Tempo di risposta medio massimo (s)
+#define QOS_GREEN_PASS_LOSS 0.3  // Frazione massima di job che saltano il controllo del green pass
+
+// Parametri della procedura di selezione di Kim e Nelson (modalità COMPARE)
+#define KN_ALPHA 0.05        // La configurazione scelta è la migliore con probabilità almeno 1 - KN_ALPHA
+#define KN_DELTA 1.0         // Zona di indifferenza: differenza di tempo di risposta giornaliero (s) sotto cui due configurazioni si equivalgono
+#define KN_FIRST_STAGE 10    // Repliche del primo stadio, usate per stimare le varianze delle differenze
+#define MAX_CONTENDERS 16    // Numero massimo di configurazioni confrontate
+
+// Lista dei completamenti: 0 = min-heap indicizzato, 1 = calendar queue (compilare con make calendar)
+#ifndef CALENDAR_QUEUE
+#define CALENDAR_QUEUE 0
+#endif
+#define CQ_MIN_BUCKETS 2
+#define CQ_MAX_BUCKETS (NUM_BLOCKS * MAX_SERVERS)
+#define CQ_SAMPLE 25  // Numero di completamenti campionati per stimare l'ampiezza dei bucket
+
+#define JOB_SLAB_BITS 12  // Ogni slab del job pool contiene 2^JOB_SLAB_BITS job
+#define JOB_SLAB_SIZE (1 << JOB_SLAB_BITS)
 
 #define handle_error(msg)   \
     do {                    \
@@ -85,12 +139,37 @@ struct sum {
     long served;     // Numero di job serviti
 };
 
-// Struttura che mantiene un job. Il puntatore *next implementa la Linked List
+typedef uint32_t job_handle;  // Riferimento compatto ad un job del job pool
+#define NO_JOB UINT32_MAX
+
+// Struttura che mantiene un job nel job pool
 struct job {
     double arrival;
-    struct job *next;
+    double entry;          // Istante di ingresso nel sistema, per il tempo di risposta del singolo job
+    job_handle next_free;  // Successivo nella free list del pool, significativo solo per i job liberi
 };
 
+// Pool di job della simulazione: slab contigue con una free list, azzerabile in O(1) tra una run e l'altra.
+// L'handle di un job è il suo indice globale: slab = handle >> JOB_SLAB_BITS
+typedef struct {
+    struct job **slabs;      // Slab allocate, riutilizzate tra le run
+    uint32_t num_slabs;
+    uint32_t capacity_slabs;
+    job_handle next_unused;  // Primo handle mai usato dall'ultimo reset
+    job_handle free_list;    // Job restituiti, concatenati tramite il campo next_free
+    long in_use;             // Job attualmente in circolazione
+    long high_water;         // Massimo numero di job contemporaneamente in circolazione nella run
+    long max_high_water;     // Massimo high water tra tutte le run
+} job_pool;
+
+// Coda FIFO di job: ring buffer crescente di handle, la capacità è sempre una potenza di 2
+typedef struct {
+    job_handle *jobs;
+    uint32_t head;      // Posizione del primo job della coda
+    uint32_t count;     // Numero di job in coda
+    uint32_t capacity;
+} job_queue;
+
 // Servente
 typedef struct server_t {
     int id;
@@ -101,6 +180,8 @@ typedef struct server_t {
     struct block *block;
     struct sum sum;
     bool need_resched;
+    int compl_pos;  // Posizione del completamento pendente nella lista dei completamenti, -1 se il server non ha completamenti
+    job_handle job;  // Job in servizio, NO_JOB se il server è IDLE
     double time_online;
     double last_online;
 } server;
@@ -109,9 +190,50 @@ typedef struct {
     int slot_config[3][NUM_BLOCKS];
 } network_configuration;
 
+// Stima analitica di un blocco: M/M/c (Erlang-C) per i blocchi con coda, M/M/c/c (Erlang-B) per il green pass
+typedef struct {
+    int servers;
+    double lambda;    // Tasso di arrivo al blocco
+    double rho;       // Utilizzazione di un server, per il green pass calcolata sul traffico accettato
+    double wait;      // Attesa media in coda (Erlang-C), 0 per il green pass
+    double response;  // Tempo medio nel blocco, per il green pass mediato anche sui job che lo saltano
+    double loss;      // Probabilità di perdita (Erlang-B), 0 per i blocchi con coda
+} analytic_block;
+
+// Soluzione analitica della rete di Jackson di uno slot
+typedef struct {
+    analytic_block blocks[NUM_BLOCKS];
+    double response_time;  // Tempo di risposta pesato con le visite, come in calculate_statistics_inf
+    bool stable;
+} analytic_network;
+
+// Parametri di un'esecuzione: partono dalle costanti di questo file, vengono letti dal file di configurazione e dalle
+// sostituzioni da riga di comando prima di ogni simulazione e restano costanti durante le simulazioni
+typedef struct {
+    double lambda[3];                 // Tassi di arrivo delle tre fasce
+    int time_slot[3];                 // Durata delle tre fasce (s)
+    double service[NUM_BLOCKS];       // Tempi medi di servizio dei blocchi, nell'ordine di enum block_types
+    double p_exit_temp;               // Percentuali di routing dal controllo temperatura, la somma deve essere 100
+    double p_ticket_buy;
+    double p_ticket_gate;
+    double p_season_gate;
+    double monthly_cost[NUM_BLOCKS];  // Costi mensili per server dei blocchi
+    network_configuration staffing;   // Piano dei serventi delle simulazioni e della soluzione analitica
+    long seed_finite;
+    long seed_infinite;
+    int repetitions;  // Repliche ad orizzonte finito e massimo di repliche del confronto, al massimo NUM_REPETITIONS
+    int batch_b;      // Dimensione delle batch della modalità SEARCH
+    int batch_k;      // Batch ad orizzonte infinito, pari e al massimo BATCH_K
+    int batch_b_min;  // Dimensione iniziale e massima delle batch ad orizzonte infinito (BATCH_B_MIN, BATCH_B_MAX)
+    int batch_b_max;
+    double batch_acf;  // Autocorrelazione di lag 1 sotto cui le batch si considerano indipendenti (BATCH_ACF)
+    char output_dir[PATH_LENGTH];
+} model_parameters;
+
 typedef struct {
     server server_list[NUM_BLOCKS][MAX_SERVERS];
     int num_online_servers[NUM_BLOCKS];
+    uint64_t idle_servers[NUM_BLOCKS][IDLE_WORDS];  // Bitmap dei server IDLE tra i primi num_online_servers di ogni blocco
     int time_slot;
     network_configuration *configuration;
 
@@ -125,9 +247,7 @@ struct area {
 
 // Blocco
 struct block {
-    struct job *head_service;
-    struct job *tail;
-    struct job *head_queue;
+    job_queue queue;  // Job in attesa nel blocco in ordine di arrivo, quelli in servizio sono sui server
     double active_time;
     int jobInQueue;
     int jobInBlock;
@@ -143,6 +263,7 @@ struct block {
     int total_dropped;   // Utilizzato per il blocco TEMPERATURE_CTRL
     double service_rate;
     struct area area;
+    double last_change;  // Istante fino al quale le aree sono state integrate, aggiornato ad ogni variazione di popolazione
 };
 
 // Struttura che mantiene un completamento su un server
@@ -151,9 +272,187 @@ typedef struct {
     double value;
 } compl ;
 
-// Struttura che mantiene la lista ordinata di tutti i completamenti
+#if CALENDAR_QUEUE
+// Struttura che mantiene tutti i completamenti pendenti in una calendar queue (Brown, 1988).
+// Ogni server ha un nodo riservato in nodes[], i bucket sono liste doppiamente collegate ordinate per valore
+typedef struct {
+    compl nodes[NUM_BLOCKS * MAX_SERVERS];
+    int next[NUM_BLOCKS * MAX_SERVERS];
+    int prev[NUM_BLOCKS * MAX_SERVERS];
+    int buckets[CQ_MAX_BUCKETS];  // Testa della lista di ogni bucket, -1 se vuoto
+    int num_buckets;
+    double width;      // Ampiezza temporale di un bucket
+    long last_bucket;  // Bucket virtuale da cui riprendere la ricerca del minimo
+    compl empty;       // Restituito quando non ci sono completamenti, ha valore INFINITY
+    int num_completions;
+} sorted_completions;
+#else
+// Struttura che mantiene tutti i completamenti pendenti in un min-heap indicizzato.
+// heap[0] è sempre il prossimo completamento, ogni server conosce la posizione (compl_pos) del proprio
 typedef struct {
-    compl sorted_list[NUM_BLOCKS * MAX_SERVERS];
+    compl heap[NUM_BLOCKS * MAX_SERVERS];
     int num_completions;
 } sorted_completions;
+#endif
+
+// Accumulatore in linea di una metrica: media e varianza con l'algoritmo di Welford, estremi e somme dei prodotti
+// ritardati per le autocovarianze come in DES/acs.c
+typedef struct {
+    long n;
+    double mean;
+    double sum;  // Somma dei quadrati degli scarti dalla media
+    double min;
+    double max;
+    double cosum[ACS_LAGS + 1];  // cosum[j] somma x[i] * x[i + j]
+    double head[ACS_LAGS];       // Prime ACS_LAGS osservazioni
+    double tail[ACS_LAGS];       // Ultime ACS_LAGS osservazioni, x[i] sta in tail[i % ACS_LAGS]
+} accumulator;
+
+// Tempi di risposta dei singoli job usciti dal sistema, nell'ordine di uscita
+typedef struct {
+    double *values;
+    long count;
+    long capacity;
+} sojourn_series;
+
+// Somme dei cicli rigenerativi completi. Un ciclo inizia con un arrivo che trova la rete vuota: i job del ciclo precedente
+// sono tutti usciti, quindi i loro tempi di risposta sono gli ultimi registrati nella serie a partire da start
+typedef struct {
+    long cycles;
+    double sum_y;   // Y = somma dei tempi di risposta dei job del ciclo
+    double sum_n;   // N = job del ciclo
+    double sum_yy;
+    double sum_nn;
+    double sum_yn;
+    long start;     // Indice nella serie del primo job del ciclo in corso, -1 prima del primo punto di rigenerazione
+} regenerative_cycles;
+
+// Contesto di una simulazione: possiede tutto lo stato di una run, compreso quello del generatore di numeri casuali,
+// così più simulazioni indipendenti possono convivere nello stesso processo. Va allocato con create_context
+typedef struct {
+    network_configuration config;
+    sorted_completions completions;   // Tiene tutti i completamenti nella rete (min-heap o calendar queue) così da ottenere rapidamente il prossimo
+    network_status network;           // Tiene lo stato complessivo della rete
+    struct block blocks[NUM_BLOCKS];  // Mantiene lo stato dei singoli blocchi della rete
+    struct clock_t clock;             // Mantiene le informazioni sul clock di simulazione
+    job_pool jobs;                    // Pool da cui vengono allocati i job in transito nella rete
+    rngs_state rng;                   // Stato dei 256 stream del generatore, attivato con SelectState dalle routine che estraggono
+    long seed;                        // Seed da cui vengono piantati gli stream, anche quelli di ogni replica
+
+    double arrival_rate;
+    int completed;
+    int dropped;
+    int bypassed;
+    bool slot_switched[3];
+    FILE *finite_csv;
+    int repetitions;  // Repliche ad orizzonte finito effettivamente eseguite
+
+    double statistics[NUM_REPETITIONS][3];
+    double infinite_statistics[BATCH_K];
+    double infinite_delay[BATCH_K][NUM_BLOCKS];
+    double repetitions_costs[NUM_REPETITIONS];
+    double global_means_p[BATCH_K][NUM_BLOCKS];
+    double global_means_p_fin[NUM_REPETITIONS][3][NUM_BLOCKS];
+    double global_loss[BATCH_K];
+    bool collect_sojourns;   // Registra in sojourns il tempo di risposta di ogni job che esce dal sistema
+    sojourn_series sojourns;
+    long in_system;              // Job presenti nella rete, per riconoscere i punti di rigenerazione
+    regenerative_cycles cycles;  // Cicli rigenerativi osservati sulla serie dei tempi di risposta (-e REG)
+    long warm_up_jobs;       // Job del transitorio iniziale scartati prima delle batch (-w MSER)
+    double warm_up_time;     // Istante da cui partono le batch
+    bool warm_up_short;      // Troncamento al limite della run pilota, che andrebbe allungata
+    int batch_b;           // Dimensione delle batch scelta dall'ultima simulazione ad orizzonte infinito
+    accumulator batch_rt;  // Metriche delle batch ad orizzonte infinito, aggiornate alla fine di ogni batch
+    accumulator batch_loss;
+    accumulator batch_delay[NUM_BLOCKS];
+    accumulator batch_utilization[NUM_BLOCKS];
+} sim_context;
+
+// Output prodotto da una replica ad orizzonte finito, bufferizzato per poterlo scrivere in ordine di replica
+typedef struct {
+    char *csv;  // Righe di continuos_finite.csv
+    size_t csv_len;
+} replication_output;
+
+// Pool di thread che si divide le repliche ad orizzonte finito. Ogni thread usa un proprio contesto,
+// i risultati di ogni replica vengono copiati nelle righe corrispondenti del contesto results
+typedef struct {
+    sim_context *results;
+    replication_output *outputs;
+    int stop_time;
+    int repetitions;
+    int next;             // Prossima replica da assegnare
+    int done;             // Repliche terminate, per la barra di avanzamento
+    int stop_at;          // Le repliche da questo indice in poi non vengono assegnate (regola di arresto sequenziale)
+    int prefix;           // Repliche consecutive, a partire dalla prima, già accumulate in rt
+    bool finished[NUM_REPETITIONS];
+    accumulator rt[3];    // Tempo di risposta delle repliche del prefisso, per ogni slot
+    accumulator cost;
+    accumulator utilization[3][NUM_BLOCKS];
+    long max_high_water;  // Massimo high water dei job pool di tutti i thread
+    uint32_t max_slabs;
+    pthread_mutex_t lock;
+} replication_pool;
+
+// Simulazioni ad orizzonte infinito dei tre slot eseguite in parallelo (modalità ALL), una per thread.
+// Ogni slot ha il proprio contesto, condividono solo il contatore della barra di avanzamento
+typedef struct {
+    sim_context *contexts[3];
+    int done;  // Batch completati da tutti gli slot
+    pthread_mutex_t lock;
+} slot_pool;
+
+typedef struct {
+    slot_pool *pool;
+    int slot;
+} slot_task;
+
+// Configurazione candidata di uno slot valutata dalla ricerca della configurazione ottima
+typedef struct {
+    int servers[NUM_BLOCKS];
+    double cost;           // Costo dello slot con questa configurazione
+    double response_time;  // Media delle batch means del tempo di risposta
+    double loss;           // Media delle batch means della percentuale di perdita del green pass
+    bool feasible;         // Rispetta entrambi i vincoli di QoS
+} candidate;
+
+// Pool di thread che valuta in parallelo un gruppo di candidati dello stesso slot, ogni thread su un proprio contesto
+typedef struct {
+    candidate *candidates;
+    int count;
+    int next;  // Prossimo candidato da valutare
+    int slot;
+    long seed;
+    pthread_mutex_t lock;
+} search_pool;
+
+// Candidati già valutati durante la ricerca di uno slot, usati per non ripetere simulazioni e per la dominanza
+typedef struct {
+    candidate *items;
+    int count;
+    int capacity;
+    int pruned;  // Candidati scartati senza simularli
+    int screened;  // Configurazioni valutate solo con il modello analitico
+} search_history;
+
+// Configurazione della giornata in gara nella procedura di selezione, con le osservazioni di ogni replica
+typedef struct {
+    network_configuration config;
+    double response_time[NUM_REPETITIONS];  // Tempo di risposta giornaliero della replica
+    double cost[NUM_REPETITIONS];
+    int eliminated;  // Numero di repliche dopo cui è stata eliminata, 0 se ancora in gara
+} contender;
+
+// Pool di thread che esegue le repliche [first_rep, last_rep) dei candidati ancora in gara. Tutti i candidati usano
+// gli stessi stream per la stessa replica (numeri casuali comuni), quindi le differenze hanno varianza ridotta
+typedef struct {
+    contender *contenders;
+    int alive[MAX_CONTENDERS];  // Indici dei candidati ancora in gara
+    int num_alive;
+    int first_rep;
+    int last_rep;
+    int next;  // Prossima coppia (candidato, replica) da eseguire
+    long seed;
+    pthread_mutex_t lock;
+} selection_pool;
 // --------------------------------------------------------------------------------------------------
\ No newline at end of file
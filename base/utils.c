@@ -1,14 +1,19 @@
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
 #include "./DES/rng.h"
 #include "./DES/rvgs.h"
+#include "./DES/rvms.h"
 #include "config.h"
 
 FILE *open_csv(char *filename);
@@ -16,6 +21,8 @@ FILE *open_csv_appendMode(char *filename);
 void *append_on_csv(FILE *fpt, double ts, double p);
 void *append_on_csv_v2(FILE *fpt, double ts, double p);
 
+model_parameters params;  // Parametri dell'esecuzione in corso, letti da tutte le routine del modello
+
 // Stampa a schermo una linea di separazione
 void print_line() {
     printf("\n————————————————————————————————————————————————————————————————————————————————————————\n");
@@ -38,11 +45,11 @@ char *stringFromEnum(enum block_types f) {
 // Fornisce il codice del blocco di destinazione partendo dal blocco del controllo temperatura
 int routing_from_temperature() {
     double random = Uniform(0, 100);
-    if (random < P_EXIT_TEMP) {
+    if (random < params.p_exit_temp) {
         return EXIT;
-    } else if (random < P_EXIT_TEMP + P_TICKET_BUY) {
+    } else if (random < params.p_exit_temp + params.p_ticket_buy) {
         return TICKET_BUY;
-    } else if (random < P_EXIT_TEMP + P_TICKET_BUY + P_SEASON_GATE) {
+    } else if (random < params.p_exit_temp + params.p_ticket_buy + params.p_season_gate) {
         return SEASON_GATE;
     } else {
         return TICKET_GATE;
@@ -66,11 +73,16 @@ int getDestination(enum block_types from) {
     }
 }
 
+// Secondi di servizio in un mese: DAYS_IN_MONTH giornate lunghe quanto la somma delle fasce di params
+double seconds_in_month(void) {
+    return (double)DAYS_IN_MONTH * (params.time_slot[0] + params.time_slot[1] + params.time_slot[2]);
+}
+
 double calculate_cost(network_status *net) {
-    double cm_costs[] = {CM_TEMPERATURE_CTRL_SERVER, CM_TICKET_BUY_SERVER, CM_SEASON_GATE_SERVER, CM_TICKET_GATE_SERVER, CM_GREEN_PASS_SERVER};
+    double *cm_costs = params.monthly_cost;
     double costs[5] = {0, 0, 0, 0, 0};
     double total = 0;
-    float sec_in_month = 60 * 60 * 19 * 30;
+    double sec_in_month = seconds_in_month();
     for (int j = 0; j < NUM_BLOCKS; j++) {
         for (int i = 0; i < MAX_SERVERS; i++) {
             server s = net->server_list[j][i];
@@ -81,11 +93,145 @@ double calculate_cost(network_status *net) {
     return total;
 }
 
+// Calcola il costo di una configurazione di uno slot come calculate_cost, supponendo ogni server online per tutta la durata
+double configuration_cost(int servers[], double duration) {
+    double *cm_costs = params.monthly_cost;
+    double total = 0;
+    double sec_in_month = seconds_in_month();
+    for (int j = 0; j < NUM_BLOCKS; j++) {
+        total += servers[j] * duration * (cm_costs[j] / sec_in_month);
+    }
+    return total;
+}
+
+// Calcola il numero medio di visite a ogni blocco di un job arrivato dall'esterno, dalle probabilità di routing
+void visit_ratios(double visits[]) {
+    visits[TEMPERATURE_CTRL] = 1;
+    visits[TICKET_BUY] = params.p_ticket_buy / 100;
+    visits[SEASON_GATE] = params.p_season_gate / 100;
+    visits[TICKET_GATE] = (params.p_ticket_buy + params.p_ticket_gate) / 100;
+    visits[GREEN_PASS] = (params.p_ticket_buy + params.p_ticket_gate + params.p_season_gate) / 100;
+}
+
+// Calcola il numero minimo di server per blocco sotto cui il blocco è instabile (c / E[S] <= lambda_i).
+// Il green pass è un sistema a perdita e resta stabile con un solo server
+void stability_bound(double lambda, int bound[]) {
+    double visits[NUM_BLOCKS];
+    double *services = params.service;
+    visit_ratios(visits);
+    for (int j = 0; j < NUM_BLOCKS; j++) {
+        bound[j] = (j == GREEN_PASS) ? 1 : (int)floor(lambda * visits[j] * services[j]) + 1;
+    }
+}
+
+// Formula di Erlang-B: probabilità che un job trovi tutti i c server occupati in un M/M/c/c con carico offerto a = lambda * E[S].
+// Usa la ricorsione B(k) = a B(k-1) / (k + a B(k-1)), stabile anche per c grandi
+double erlang_b(int c, double a) {
+    double b = 1;
+    for (int k = 1; k <= c; k++) {
+        b = a * b / (k + a * b);
+    }
+    return b;
+}
+
+// Formula di Erlang-C: probabilità di attesa in coda in un M/M/c con carico offerto a. Vale 1 se il blocco è instabile (a >= c)
+double erlang_c(int c, double a) {
+    if (a >= c) {
+        return 1;
+    }
+    double b = erlang_b(c, a);
+    return b / (1 - (a / c) * (1 - b));
+}
+
+// Costante di normalizzazione della distribuzione stazionaria di un M/M/c con carico offerto a, oppure di un M/M/c/c se
+// loss è vero: i termini a^n / n! fino a c più, per il blocco con coda, la coda geometrica di ragione a / c oltre c
+double population_total(int c, double a, bool loss) {
+    double term = 1;
+    double total = 1;
+    for (int k = 1; k <= c; k++) {
+        term *= a / k;
+        total += term;
+    }
+    if (!loss) {
+        total += term * (a / c) / (1 - a / c);
+    }
+    return total;
+}
+
+// Probabilità che il blocco stazionario sia vuoto, 0 se il blocco con coda è instabile (a >= c)
+double empty_probability(int c, double a, bool loss) {
+    if (c <= 0 || (!loss && a >= c)) {
+        return 0;
+    }
+    return 1 / population_total(c, a, loss);
+}
+
+// Estrae per inversione con l'uniforme u il numero di job presenti in un M/M/c stazionario con carico offerto a, oppure in un
+// M/M/c/c se loss è vero. I termini della distribuzione vengono accumulati finché la cumulata supera u. Ritorna 0 se il
+// blocco con coda è instabile (a >= c), perché non ha una distribuzione stazionaria
+int stationary_population(int c, double a, bool loss, double u) {
+    if (c <= 0 || (!loss && a >= c)) {
+        return 0;
+    }
+    double total = population_total(c, a, loss);
+
+    int n = 0;
+    double term = 1;
+    double cumulative = term / total;
+    while (cumulative < u && (n < c || !loss)) {
+        n++;
+        term *= a / (n < c ? n : c);
+        if (term / total < 1e-300) {
+            break;  // Resto della coda numericamente nullo
+        }
+        cumulative += term / total;
+    }
+    return n;
+}
+
+// Risolve analiticamente la rete di uno slot con la configurazione data: ogni blocco con coda è un M/M/c con arrivi
+// lambda * visite (rete di Jackson), il green pass un M/M/c/c. Non simula nulla, quindi serve a scartare in pochi
+// microsecondi le configurazioni da non simulare e a confrontare le stime di calculate_statistics_inf
+void solve_analytic(network_configuration *config, int slot, analytic_network *out) {
+    double *lambdas = params.lambda;
+    double *services = params.service;
+    double visits[NUM_BLOCKS];
+    visit_ratios(visits);
+
+    out->stable = true;
+    out->response_time = 0;
+    for (int j = 0; j < NUM_BLOCKS; j++) {
+        analytic_block *b = &out->blocks[j];
+        int c = config->slot_config[slot][j];
+        double a = lambdas[slot] * visits[j] * services[j];
+        b->servers = c;
+        b->lambda = lambdas[slot] * visits[j];
+        b->wait = 0;
+        b->loss = 0;
+
+        if (j == GREEN_PASS) {
+            b->loss = erlang_b(c, a);
+            b->rho = (c > 0) ? a * (1 - b->loss) / c : 0;
+            b->response = (1 - b->loss) * services[j];
+        } else if (a >= c) {
+            b->rho = (c > 0) ? a / c : INFINITY;
+            b->wait = INFINITY;
+            b->response = INFINITY;
+            out->stable = false;
+        } else {
+            b->rho = a / c;
+            b->wait = erlang_c(c, a) * services[j] / (c - a);
+            b->response = b->wait + services[j];
+        }
+        out->response_time += visits[j] * b->response;
+    }
+}
+
 void print_real_cost(network_status *net) {
-    double cm_costs[] = {CM_TEMPERATURE_CTRL_SERVER, CM_TICKET_BUY_SERVER, CM_SEASON_GATE_SERVER, CM_TICKET_GATE_SERVER, CM_GREEN_PASS_SERVER};
+    double *cm_costs = params.monthly_cost;
     double costs[5] = {0, 0, 0, 0, 0};
     double total = 0;
-    float sec_in_month = 60 * 60 * 19 * 30;
+    double sec_in_month = seconds_in_month();
     print_line();
     printf("Analisi Costi\n");
     for (int j = 0; j < NUM_BLOCKS; j++) {
@@ -102,24 +248,24 @@ void print_real_cost(network_status *net) {
 // Stampa i dettagli sui costi della configurazione
 void print_cost_theor(network_configuration conf) {
     int seconds;
-    int slots[] = {TIME_SLOT_1, TIME_SLOT_2, TIME_SLOT_3};
-    float sec_in_month = 60 * 60 * 19 * 30;
+    int *slots = params.time_slot;
+    double sec_in_month = seconds_in_month();
     for (int slot = 0; slot < 3; slot++) {
         seconds = slots[slot];
         printf("\n-- Costo Fascia #%d --", slot);
-        double temp_c = CM_TEMPERATURE_CTRL_SERVER / sec_in_month * conf.slot_config[slot][TEMPERATURE_CTRL] * seconds;
+        double temp_c = params.monthly_cost[TEMPERATURE_CTRL] / sec_in_month * conf.slot_config[slot][TEMPERATURE_CTRL] * seconds;
         printf("Costo Controllo Temperatura: %f\n", temp_c);
 
-        double buy_c = CM_TICKET_BUY_SERVER / sec_in_month * conf.slot_config[slot][TICKET_BUY] * seconds;
+        double buy_c = params.monthly_cost[TICKET_BUY] / sec_in_month * conf.slot_config[slot][TICKET_BUY] * seconds;
         printf("Costo Acquisto Biglietti: %f\n", buy_c);
 
-        double ticket_c = CM_TICKET_GATE_SERVER / sec_in_month * conf.slot_config[slot][TICKET_GATE] * seconds;
+        double ticket_c = params.monthly_cost[TICKET_GATE] / sec_in_month * conf.slot_config[slot][TICKET_GATE] * seconds;
         printf("Costo Verifica Biglietti: %f\n", ticket_c);
 
-        double season_c = CM_SEASON_GATE_SERVER / sec_in_month * conf.slot_config[slot][SEASON_GATE] * seconds;
+        double season_c = params.monthly_cost[SEASON_GATE] / sec_in_month * conf.slot_config[slot][SEASON_GATE] * seconds;
         printf("Costo Verifica Abbonamenti: %f\n", season_c);
 
-        double green_c = CM_GREEN_PASS_SERVER / sec_in_month * conf.slot_config[slot][GREEN_PASS] * seconds;
+        double green_c = params.monthly_cost[GREEN_PASS] / sec_in_month * conf.slot_config[slot][GREEN_PASS] * seconds;
         printf("Costo Verifica Green Pass: %f\n", green_c);
 
         double total = temp_c + buy_c + ticket_c + season_c + green_c;
@@ -148,57 +294,506 @@ void clearScreen() {
     printf("\033[H\033[2J");
 }
 
-// Ricerca binaria di un elemento su una lista ordinata
-int binarySearch(sorted_completions *compls, int low, int high, compl completion) {
-    if (high < low) {
-        return -1;
+// Aggiorna l'indice dei server liberi: il bit del server è acceso se è IDLE e rientra tra i server attivi del blocco
+void update_idle_index(network_status *network, server *s) {
+    int block = s->block->type;
+    uint64_t mask = (uint64_t)1 << (s->id % 64);
+
+    if (s->status == IDLE && s->id < network->num_online_servers[block]) {
+        network->idle_servers[block][s->id / 64] |= mask;
+    } else {
+        network->idle_servers[block][s->id / 64] &= ~mask;
+    }
+}
+
+// Ritorna il server libero con indice minore nel blocco, NULL se sono tutti occupati
+server *first_idle_server(network_status *network, int block) {
+    for (int w = 0; w < IDLE_WORDS; w++) {
+        uint64_t word = network->idle_servers[block][w];
+        if (word != 0) {
+            return &network->server_list[block][w * 64 + __builtin_ctzll(word)];
+        }
+    }
+    return NULL;
+}
+
+// Integra le aree del blocco dall'ultima variazione fino all'istante now. Va chiamata prima di modificare jobInBlock o jobInQueue
+void integrate_block(struct block *b, double now) {
+    if (b->jobInBlock > 0) {
+        b->area.node += (now - b->last_change) * b->jobInBlock;
+        b->area.queue += (now - b->last_change) * b->jobInQueue;
+    }
+    b->last_change = now;
+}
+
+// Porta le aree di tutti i blocchi all'istante now, prima di leggerle per il calcolo delle statistiche
+void flush_areas(struct block blocks[], double now) {
+    for (int i = 0; i < NUM_BLOCKS; i++) {
+        integrate_block(&blocks[i], now);
+    }
+}
+
+// Ritorna il job corrispondente all'handle
+struct job *get_job(job_pool *pool, job_handle h) {
+    return &pool->slabs[h >> JOB_SLAB_BITS][h & (JOB_SLAB_SIZE - 1)];
+}
+
+// Preleva un job dal pool: prima dalla free list, poi dai job mai usati, allocando una nuova slab solo se necessario
+job_handle alloc_job(job_pool *pool) {
+    job_handle h;
+
+    if (pool->free_list != NO_JOB) {
+        h = pool->free_list;
+        pool->free_list = get_job(pool, h)->next_free;
+    } else {
+        h = pool->next_unused++;
+        if ((h >> JOB_SLAB_BITS) == pool->num_slabs) {
+            if (pool->num_slabs == pool->capacity_slabs) {
+                pool->capacity_slabs = pool->capacity_slabs ? 2 * pool->capacity_slabs : 8;
+                pool->slabs = realloc(pool->slabs, pool->capacity_slabs * sizeof(struct job *));
+                if (pool->slabs == NULL)
+                    handle_error("realloc");
+            }
+            pool->slabs[pool->num_slabs] = malloc(JOB_SLAB_SIZE * sizeof(struct job));
+            if (pool->slabs[pool->num_slabs] == NULL)
+                handle_error("malloc");
+            pool->num_slabs++;
+        }
+    }
+
+    pool->in_use++;
+    if (pool->in_use > pool->high_water) {
+        pool->high_water = pool->in_use;
+        if (pool->high_water > pool->max_high_water) {
+            pool->max_high_water = pool->high_water;
+        }
+    }
+    return h;
+}
+
+// Restituisce un job al pool inserendolo in testa alla free list
+void free_job(job_pool *pool, job_handle h) {
+    get_job(pool, h)->next_free = pool->free_list;
+    pool->free_list = h;
+    pool->in_use--;
+}
+
+// Rende di nuovo disponibili tutti i job del pool in O(1), mantenendo le slab già allocate
+void reset_job_pool(job_pool *pool) {
+    pool->next_unused = 0;
+    pool->free_list = NO_JOB;
+    pool->in_use = 0;
+    pool->high_water = 0;
+}
+
+// Libera tutte le slab del pool, che torna vuoto
+void free_job_pool(job_pool *pool) {
+    for (uint32_t i = 0; i < pool->num_slabs; i++) {
+        free(pool->slabs[i]);
+    }
+    free(pool->slabs);
+    *pool = (job_pool){.free_list = NO_JOB};
+}
+
+// Garantisce che la coda possa contenere almeno n job, raddoppiando il ring buffer e srotolandone il contenuto
+void reserve_queue(job_queue *q, uint32_t n) {
+    if (n <= q->capacity) {
+        return;
+    }
+    uint32_t capacity = q->capacity ? q->capacity : 8;
+    while (capacity < n) {
+        capacity *= 2;
+    }
+
+    job_handle *jobs = malloc(capacity * sizeof(job_handle));
+    if (jobs == NULL)
+        handle_error("malloc");
+
+    uint32_t first = q->capacity - q->head;  // Job tra head e la fine del vecchio buffer
+    if (first > q->count) {
+        first = q->count;
+    }
+    if (q->count > 0) {
+        memcpy(jobs, &q->jobs[q->head], first * sizeof(job_handle));
+        memcpy(&jobs[first], q->jobs, (q->count - first) * sizeof(job_handle));
+    }
+    free(q->jobs);
+    q->jobs = jobs;
+    q->head = 0;
+    q->capacity = capacity;
+}
+
+// Accoda un job in fondo alla coda
+void push_job(job_queue *q, job_handle h) {
+    if (q->count == q->capacity) {
+        reserve_queue(q, q->count + 1);
+    }
+    q->jobs[(q->head + q->count) & (q->capacity - 1)] = h;
+    q->count++;
+}
+
+// Estrae il job in testa alla coda
+job_handle pop_job(job_queue *q) {
+    job_handle h = q->jobs[q->head];
+    q->head = (q->head + 1) & (q->capacity - 1);
+    q->count--;
+    return h;
+}
+
+// Sposta gli ultimi n job di src in fondo a dst mantenendone l'ordine, copiando a blocchi contigui
+void move_tail_jobs(job_queue *src, job_queue *dst, uint32_t n) {
+    reserve_queue(dst, dst->count + n);
+
+    uint32_t offset = src->count - n;
+    src->count -= n;
+    while (n > 0) {
+        uint32_t from = (src->head + offset) & (src->capacity - 1);
+        uint32_t to = (dst->head + dst->count) & (dst->capacity - 1);
+        uint32_t chunk = n;
+        if (chunk > src->capacity - from) {
+            chunk = src->capacity - from;
+        }
+        if (chunk > dst->capacity - to) {
+            chunk = dst->capacity - to;
+        }
+        memcpy(&dst->jobs[to], &src->jobs[from], chunk * sizeof(job_handle));
+        dst->count += chunk;
+        offset += chunk;
+        n -= chunk;
+    }
+}
+
+// Svuota la coda mantenendo il buffer allocato
+void clear_queue(job_queue *q) {
+    q->head = 0;
+    q->count = 0;
+}
+
+// Libera il buffer della coda
+void free_queue(job_queue *q) {
+    free(q->jobs);
+    q->jobs = NULL;
+    q->head = 0;
+    q->count = 0;
+    q->capacity = 0;
+}
+
+#if CALENDAR_QUEUE
+// Indice del nodo della calendar queue riservato al server: ogni server ha al più un completamento pendente
+int completionSlot(server *s) {
+    return s->block->type * MAX_SERVERS + s->id;
+}
+
+// Ritorna l'anno virtuale (indice del bucket non ridotto modulo num_buckets) di un istante
+long virtualBucket(sorted_completions *compls, double value) {
+    return (long)(value / compls->width);
+}
+
+// Inserisce il nodo nella lista ordinata del bucket corrispondente al suo valore
+void linkCompletion(sorted_completions *compls, int slot) {
+    double value = compls->nodes[slot].value;
+    long vb = virtualBucket(compls, value);
+    int b = vb % compls->num_buckets;
+    int prev = -1;
+    int cur = compls->buckets[b];
+
+    while (cur != -1 && compls->nodes[cur].value <= value) {
+        prev = cur;
+        cur = compls->next[cur];
+    }
+    compls->prev[slot] = prev;
+    compls->next[slot] = cur;
+    if (cur != -1) {
+        compls->prev[cur] = slot;
+    }
+    if (prev != -1) {
+        compls->next[prev] = slot;
+    } else {
+        compls->buckets[b] = slot;
+    }
+    if (compls->num_completions == 0 || vb < compls->last_bucket) {
+        compls->last_bucket = vb;  // Un completamento precedente all'ultimo estratto riporta indietro la scansione
+    }
+}
+
+// Stacca il nodo dalla lista del proprio bucket
+void unlinkCompletion(sorted_completions *compls, int slot) {
+    int prev = compls->prev[slot];
+    int next = compls->next[slot];
+
+    if (prev != -1) {
+        compls->next[prev] = next;
+    } else {
+        compls->buckets[virtualBucket(compls, compls->nodes[slot].value) % compls->num_buckets] = next;
+    }
+    if (next != -1) {
+        compls->prev[next] = prev;
+    }
+}
+
+int compareDouble(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Stima la larghezza dei bucket come 3 volte la separazione media tra i primi completamenti pendenti (Brown, 1988)
+double estimateWidth(sorted_completions *compls) {
+    double values[NUM_BLOCKS * MAX_SERVERS];
+    int n = 0;
+
+    for (int slot = 0; slot < NUM_BLOCKS * MAX_SERVERS; slot++) {
+        if (compls->nodes[slot].server != NULL) {
+            values[n++] = compls->nodes[slot].value;
+        }
+    }
+    if (n < 2) {
+        return compls->width;
+    }
+    qsort(values, n, sizeof(double), compareDouble);
+    if (n > CQ_SAMPLE) {
+        n = CQ_SAMPLE;
     }
-    int mid = (low + high) / 2;
-    if (completion.value == compls->sorted_list[mid].value) {
-        return mid;
+
+    double avg = (values[n - 1] - values[0]) / (n - 1);
+    double sum = 0;
+    int count = 0;
+    for (int i = 1; i < n; i++) {
+        double gap = values[i] - values[i - 1];
+        if (gap <= 2 * avg) {  // Scarta le separazioni anomale che gonfierebbero la stima
+            sum += gap;
+            count++;
+        }
     }
-    if (completion.value == compls->sorted_list[mid].value) {
-        return binarySearch(compls, (mid + 1), high, completion);
+    if (count == 0 || sum == 0) {
+        return compls->width;
     }
-    return binarySearch(compls, low, (mid - 1), completion);
+    return 3.0 * sum / count;
 }
 
-// Inserisce un elemento nella lista ordinata
-int insertSorted(sorted_completions *compls, compl completion) {
-    int i;
+// Ridimensiona il calendario a num_buckets bucket ricalcolandone la larghezza e ridistribuendo i completamenti
+void resizeCompletions(sorted_completions *compls, int num_buckets) {
     int n = compls->num_completions;
 
-    for (i = n - 1; (i >= 0 && (compls->sorted_list[i].value > completion.value)); i--) {
-        compls->sorted_list[i + 1] = compls->sorted_list[i];
+    compls->width = estimateWidth(compls);
+    compls->num_buckets = num_buckets;
+    for (int b = 0; b < num_buckets; b++) {
+        compls->buckets[b] = -1;
+    }
+    compls->num_completions = 0;
+    for (int slot = 0; slot < NUM_BLOCKS * MAX_SERVERS; slot++) {
+        if (compls->nodes[slot].server != NULL) {
+            linkCompletion(compls, slot);
+            compls->num_completions++;
+        }
+    }
+    compls->num_completions = n;
+}
+
+// Svuota la calendar queue. La larghezza iniziale dei bucket è ricavata dai tempi medi di servizio dei blocchi
+void initCompletions(sorted_completions *compls) {
+    double *serv = params.service;
+    double rate = 0;
+    for (int i = 0; i < NUM_BLOCKS; i++) {
+        rate += 1.0 / serv[i];
+    }
+
+    compls->num_completions = 0;
+    compls->num_buckets = CQ_MIN_BUCKETS;
+    compls->width = 3.0 / rate;  // Separazione attesa con un server occupato per blocco
+    compls->last_bucket = 0;
+    for (int b = 0; b < CQ_MAX_BUCKETS; b++) {
+        compls->buckets[b] = -1;
     }
-    compls->sorted_list[i + 1] = completion;
+    for (int slot = 0; slot < NUM_BLOCKS * MAX_SERVERS; slot++) {
+        compls->nodes[slot].server = NULL;
+        compls->nodes[slot].value = INFINITY;
+    }
+    compls->empty.server = NULL;
+    compls->empty.value = INFINITY;
+}
+
+// Inserisce il completamento del server nella calendar queue in O(1) ammortizzato
+int insertCompletion(sorted_completions *compls, compl completion) {
+    int slot = completionSlot(completion.server);
+
+    compls->nodes[slot] = completion;
+    completion.server->compl_pos = slot;
+    linkCompletion(compls, slot);
     compls->num_completions++;
 
-    return (n + 1);
+    if (compls->num_completions > 2 * compls->num_buckets && compls->num_buckets < CQ_MAX_BUCKETS) {
+        resizeCompletions(compls, 2 * compls->num_buckets);
+    }
+    return compls->num_completions;
+}
+
+// Elimina il completamento pendente del server dalla calendar queue in O(1) ammortizzato
+int deleteCompletion(sorted_completions *compls, server *s) {
+    int slot = s->compl_pos;
+
+    if (slot < 0) {
+        printf("Element not found");
+        return compls->num_completions;
+    }
+
+    unlinkCompletion(compls, slot);
+    compls->nodes[slot].server = NULL;
+    compls->nodes[slot].value = INFINITY;
+    s->compl_pos = -1;
+    compls->num_completions--;
+
+    if (compls->num_completions < compls->num_buckets / 2 && compls->num_buckets > CQ_MIN_BUCKETS) {
+        resizeCompletions(compls, compls->num_buckets / 2);
+    }
+    return compls->num_completions;
+}
+
+// Riprogramma il completamento pendente del server spostandolo nel bucket del nuovo istante
+void updateCompletion(sorted_completions *compls, server *s, double value) {
+    int slot = s->compl_pos;
+
+    unlinkCompletion(compls, slot);
+    compls->num_completions--;
+    compls->nodes[slot].value = value;
+    linkCompletion(compls, slot);
+    compls->num_completions++;
 }
 
-// Function to delete an element
-int deleteElement(sorted_completions *compls, compl completion) {
+// Ritorna il prossimo completamento scorrendo i bucket a partire dall'ultimo estratto
+compl *getNextCompletion(sorted_completions *compls) {
+    if (compls->num_completions == 0) {
+        return &compls->empty;
+    }
+
+    long vb = compls->last_bucket;
+    for (int i = 0; i < compls->num_buckets; i++, vb++) {
+        int head = compls->buckets[vb % compls->num_buckets];
+        if (head != -1 && virtualBucket(compls, compls->nodes[head].value) <= vb) {
+            compls->last_bucket = vb;
+            return &compls->nodes[head];
+        }
+    }
+
+    // Nessun completamento nell'anno corrente: ricerca diretta del minimo tra le teste dei bucket
+    int min_slot = -1;
+    for (int b = 0; b < compls->num_buckets; b++) {
+        int head = compls->buckets[b];
+        if (head != -1 && (min_slot == -1 || compls->nodes[head].value < compls->nodes[min_slot].value)) {
+            min_slot = head;
+        }
+    }
+    compls->last_bucket = virtualBucket(compls, compls->nodes[min_slot].value);
+    return &compls->nodes[min_slot];
+}
+
+#else
+
+// Scambia due completamenti nell'heap aggiornando la posizione salvata nei rispettivi server
+void swapCompletions(sorted_completions *compls, int i, int j) {
+    compl tmp = compls->heap[i];
+    compls->heap[i] = compls->heap[j];
+    compls->heap[j] = tmp;
+    compls->heap[i].server->compl_pos = i;
+    compls->heap[j].server->compl_pos = j;
+}
+
+// Fa risalire il completamento in posizione pos finché il padre non ha un valore minore o uguale
+void siftUp(sorted_completions *compls, int pos) {
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (compls->heap[parent].value <= compls->heap[pos].value) {
+            break;
+        }
+        swapCompletions(compls, pos, parent);
+        pos = parent;
+    }
+}
+
+// Fa scendere il completamento in posizione pos finché i figli non hanno valori maggiori o uguali
+void siftDown(sorted_completions *compls, int pos) {
+    int n = compls->num_completions;
+    while (true) {
+        int smallest = pos;
+        int left = 2 * pos + 1;
+        int right = left + 1;
+        if (left < n && compls->heap[left].value < compls->heap[smallest].value) {
+            smallest = left;
+        }
+        if (right < n && compls->heap[right].value < compls->heap[smallest].value) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            break;
+        }
+        swapCompletions(compls, pos, smallest);
+        pos = smallest;
+    }
+}
+
+// Svuota l'heap dei completamenti. La radice vuota ha valore INFINITY, così il prossimo evento è sempre un arrivo
+void initCompletions(sorted_completions *compls) {
+    compls->num_completions = 0;
+    compls->heap[0].server = NULL;
+    compls->heap[0].value = INFINITY;
+}
+
+// Inserisce il completamento del server nell'heap in O(log(N))
+int insertCompletion(sorted_completions *compls, compl completion) {
     int n = compls->num_completions;
 
-    int pos = binarySearch(compls, 0, n - 1, completion);
+    compls->heap[n] = completion;
+    completion.server->compl_pos = n;
+    compls->num_completions++;
+    siftUp(compls, n);
+
+    return (n + 1);
+}
+
+// Elimina il completamento pendente del server dall'heap in O(log(N))
+int deleteCompletion(sorted_completions *compls, server *s) {
+    int n = compls->num_completions;
+    int pos = s->compl_pos;
 
-    if (pos == -1) {
+    if (pos < 0) {
         printf("Element not found");
         return n;
     }
 
-    // Deleting element
-    int i;
-    for (i = pos; i < n; i++) {
-        compls->sorted_list[i] = compls->sorted_list[i + 1];
-    }
-    compls->sorted_list[n - 1].value = INFINITY;
+    s->compl_pos = -1;
     compls->num_completions--;
+    if (pos != n - 1) {
+        compls->heap[pos] = compls->heap[n - 1];
+        compls->heap[pos].server->compl_pos = pos;
+        siftDown(compls, pos);
+        siftUp(compls, pos);
+    }
+    if (compls->num_completions == 0) {
+        initCompletions(compls);
+    }
 
     return n - 1;
 }
 
+// Riprogramma il completamento pendente del server ad un nuovo istante in O(log(N))
+void updateCompletion(sorted_completions *compls, server *s, double value) {
+    int pos = s->compl_pos;
+    double old = compls->heap[pos].value;
+
+    compls->heap[pos].value = value;
+    if (value < old) {
+        siftUp(compls, pos);
+    } else {
+        siftDown(compls, pos);
+    }
+}
+
+// Ritorna il prossimo completamento, che si trova sempre alla radice dell'heap
+compl *getNextCompletion(sorted_completions *compls) {
+    return &compls->heap[0];
+}
+#endif
+
 void print_block_status(sorted_completions *compls, struct block blocks[], int dropped, int completions, int bypassed) {
     printf("\n============================================================================================================\n");
     printf("Busy Servers: %d | Dropped: %d | Completions: %d | Bypassed: %d\n", compls->num_completions, dropped, completions, bypassed);
@@ -214,8 +809,18 @@ void print_block_status(sorted_completions *compls, struct block blocks[], int d
 
 // Stampa lo stato attuale dei completamenti da processare
 void print_completion_status(sorted_completions *compls) {
-    for (int i = 0; i < compls->num_completions; i++) {
-        compl actual = compls->sorted_list[i];
+#if CALENDAR_QUEUE
+    compl *list = compls->nodes;
+    int n = NUM_BLOCKS * MAX_SERVERS;
+#else
+    compl *list = compls->heap;
+    int n = compls->num_completions;
+#endif
+    for (int i = 0; i < n; i++) {
+        compl actual = list[i];
+        if (actual.server == NULL) {
+            continue;
+        }
         printf("(%d,%d)  %d  %f\n", actual.server->block->type, actual.server->id, actual.server->status, actual.value);
     }
 }
@@ -246,33 +851,23 @@ void debug_routing() {
     exit(0);
 }
 
-// Calcola le statistiche ogni 5 minuti per l'analisi nel continuo
-void calculate_statistics_clock(network_status *network, struct block blocks[], double currentClock) {
-    char filename[100];
-    snprintf(filename, 100, "results/finite/continuos_finite.csv");
-    FILE *csv;
-    csv = open_csv_appendMode(filename);
+// Numero medio di server del blocco dall'inizio della giornata: i server di ogni fascia già trascorsa pesano quanto la sua durata
+double weighted_servers(network_status *network, int block) {
+    int slot = network->time_slot;
+    double servers = (double)network->num_online_servers[block] * params.time_slot[slot];
+    double duration = params.time_slot[slot];
+    for (int k = 0; k < slot; k++) {
+        servers += (double)network->configuration->slot_config[k][block] * params.time_slot[k];
+        duration += params.time_slot[k];
+    }
+    return servers / duration;
+}
 
+// Calcola le statistiche ogni 5 minuti per l'analisi nel continuo
+void calculate_statistics_clock(network_status *network, struct block blocks[], double currentClock, FILE *csv) {
     double visit_rt = 0;
-    int time_slot = network->time_slot;
-    double m = 0.0;
     for (int i = 0; i < NUM_BLOCKS; i++) {
-        if (time_slot == 0) {
-            m = network->num_online_servers[i];
-        }
-
-        else if (time_slot == 1) {
-            double s1 = network->configuration->slot_config[0][i];
-            double s2 = network->num_online_servers[i];
-            m = (3.0 * s1 + 11.0 * s2) / 14.0;
-        }
-
-        else if (time_slot == 2) {
-            double s1 = network->configuration->slot_config[0][i];
-            double s2 = network->configuration->slot_config[1][i];
-            double s3 = network->num_online_servers[i];
-            m = (3.0 * s1 + 11.0 * s2 + 5.0 * s3) / 19.0;
-        }
+        double m = weighted_servers(network, i);
 
         int arr = blocks[i].total_arrivals;
         int r_arr = arr - blocks[i].total_bypassed;
@@ -294,31 +889,14 @@ void calculate_statistics_clock(network_status *network, struct block blocks[],
         visit_rt += wait * visit;
     }
     append_on_csv_v2(csv, visit_rt, currentClock);
-    fclose(csv);
 }
 
 // Calcola le statistiche specificate
-void calculate_statistics_fin(network_status *network, struct block blocks[], double currentClock, double rt_arr[NUM_REPETITIONS][3], int rep) {
+void calculate_statistics_fin(network_status *network, struct block blocks[], double currentClock, double rt_arr[NUM_REPETITIONS][3], double p_arr[NUM_REPETITIONS][3][NUM_BLOCKS], int rep) {
     double visit_rt = 0;
     int time_slot = network->time_slot;
-    double m = 0.0;
     for (int i = 0; i < NUM_BLOCKS; i++) {
-        if (time_slot == 0) {
-            m = network->num_online_servers[i];
-        }
-
-        else if (time_slot == 1) {
-            double s1 = network->configuration->slot_config[0][i];
-            double s2 = network->num_online_servers[i];
-            m = (3.0 * s1 + 11.0 * s2) / 14.0;
-        }
-
-        else if (time_slot == 2) {
-            double s1 = network->configuration->slot_config[0][i];
-            double s2 = network->configuration->slot_config[1][i];
-            double s3 = network->num_online_servers[i];
-            m = (3.0 * s1 + 11.0 * s2 + 5.0 * s3) / 19.0;
-        }
+        double m = weighted_servers(network, i);
 
         int arr = blocks[i].total_arrivals;
         int r_arr = arr - blocks[i].total_bypassed;
@@ -339,7 +917,9 @@ void calculate_statistics_fin(network_status *network, struct block blocks[], do
         double visit = throughput / external_arrival_rate;
         visit_rt += wait * visit;
 
-        double utilization = lambda_i / (m * mu);
+        // Il green pass scarta i job in eccesso: l'utilizzazione si calcola sui soli job accettati
+        double utilization = (r_arr / currentClock) / (m * mu);
+        p_arr[rep][time_slot][i] = utilization;
     }
     rt_arr[rep][time_slot] = visit_rt;
 }
@@ -426,11 +1006,11 @@ void print_statistics(network_status *network, struct block blocks[], double cur
 // Stampa tutte le utilizzazioni ad orizzonte finito su un file csv
 void print_p_on_csv(network_status *network, double currentClock, int slot) {
     FILE *csv;
-    char filename[100];
+    char filename[PATH_LENGTH + 64];
 
     for (int i = 0; i < NUM_BLOCKS; i++) {
         double p = 0;
-        snprintf(filename, 100, "results/finite/u_%d_finite_slot%d.csv", i, slot);
+        snprintf(filename, sizeof(filename), "%s/finite/u_%d_finite_slot%d.csv", params.output_dir, i, slot);
         csv = open_csv(filename);
         for (int j = 0; j < MAX_SERVERS; j++) {
             server *s = &network->server_list[i][j];
@@ -525,3 +1105,452 @@ void print_configuration(network_configuration *config) {
         }
     }
 }
+
+// Aggiunge un'osservazione all'accumulatore
+void acc_add(accumulator *a, double x) {
+    if (a->n == 0 || x < a->min) {
+        a->min = x;
+    }
+    if (a->n == 0 || x > a->max) {
+        a->max = x;
+    }
+    a->cosum[0] += x * x;
+    for (long j = 1; j <= ACS_LAGS && j <= a->n; j++) {
+        a->cosum[j] += x * a->tail[(a->n - j) % ACS_LAGS];
+    }
+    if (a->n < ACS_LAGS) {
+        a->head[a->n] = x;
+    }
+    a->tail[a->n % ACS_LAGS] = x;
+
+    a->n++;
+    double diff = x - a->mean;
+    a->sum += diff * diff * (a->n - 1.0) / a->n;
+    a->mean += diff / a->n;
+}
+
+// Deviazione standard delle osservazioni, come in DES/uvs.c
+double acc_stdev(accumulator *a) {
+    if (a->n == 0) {
+        return 0;
+    }
+    return sqrt(a->sum / a->n);
+}
+
+// Semiampiezza dell'intervallo di confidenza della media, calcolata come in DES/estimate.c
+double acc_half_width(accumulator *a) {
+    if (a->n < 2) {
+        return INFINITY;
+    }
+    double u = 1.0 - 0.5 * (1.0 - CONFIDENCE);
+    double t = idfStudent(a->n - 1, u);
+    return t * acc_stdev(a) / sqrt(a->n - 1);
+}
+
+// Autocorrelazione di lag j come in DES/acs.c, ma con i prodotti centrati sulla media: le somme delle prime e
+// delle ultime j osservazioni evitano la cancellazione quando la varianza è piccola rispetto al quadrato della media
+double acc_autocorrelation(accumulator *a, int j) {
+    if (j > ACS_LAGS || a->n <= j || a->sum <= 0) {
+        return 0;
+    }
+    double first = 0;
+    double last = 0;
+    for (long i = 0; i < j; i++) {
+        first += a->head[i];
+        last += a->tail[(a->n - 1 - i) % ACS_LAGS];
+    }
+    double total = a->n * a->mean;
+    double cov = (a->cosum[j] - a->mean * (2 * total - first - last) + (a->n - j) * a->mean * a->mean) / (a->n - j);
+    return cov / (a->sum / a->n);
+}
+
+// Apre il file di riepilogo delle metriche e ne scrive l'intestazione
+FILE *open_summary(char *filename) {
+    FILE *fpt = open_csv(filename);
+    fprintf(fpt, "metric;n;mean;stdev;min;max;half_width");
+    for (int j = 1; j <= ACS_LAGS; j++) {
+        fprintf(fpt, ";r%d", j);
+    }
+    fprintf(fpt, "\n");
+    return fpt;
+}
+
+// Scrive una riga di riepilogo: statistiche di DES/uvs.c, semiampiezza di DES/estimate.c e autocorrelazioni di DES/acs.c
+void append_summary(FILE *fpt, char *metric, accumulator *a) {
+    fprintf(fpt, "%s;%ld;%f;%f;%f;%f;%f", metric, a->n, a->mean, acc_stdev(a), a->min, a->max, acc_half_width(a));
+    for (int j = 1; j <= ACS_LAGS; j++) {
+        fprintf(fpt, ";%f", acc_autocorrelation(a, j));
+    }
+    fprintf(fpt, "\n");
+}
+
+// Aggiunge un tempo di risposta alla serie, raddoppiandone la capacità quando è piena. I job della popolazione iniziale
+// stazionaria hanno ingresso sconosciuto (NAN) e non vengono registrati
+void record_sojourn(sojourn_series *series, double value) {
+    if (isnan(value)) {
+        return;
+    }
+    if (series->count == series->capacity) {
+        long capacity = series->capacity ? 2 * series->capacity : 4096;
+        double *values = realloc(series->values, capacity * sizeof(double));
+        if (values == NULL) {
+            handle_error("realloc");
+        }
+        series->values = values;
+        series->capacity = capacity;
+    }
+    series->values[series->count++] = value;
+}
+
+// Semiampiezza dell'intervallo di confidenza di una stima con la varianza e i gradi di libertà dati
+double confidence_half_width(double variance, long dof) {
+    double u = 1.0 - 0.5 * (1.0 - CONFIDENCE);
+    return idfStudent(dof, u) * sqrt(variance);
+}
+
+// Chiude il ciclo rigenerativo in corso, aggiungendo alle somme i job registrati nella serie dal suo inizio, e ne apre uno
+// nuovo. Il primo ciclo, che parte dallo stato iniziale e non da un punto di rigenerazione, viene scartato
+void close_cycle(regenerative_cycles *r, sojourn_series *series) {
+    if (r->start >= 0) {
+        double y = 0;
+        for (long i = r->start; i < series->count; i++) {
+            y += series->values[i];
+        }
+        double n = (double)(series->count - r->start);
+        r->cycles++;
+        r->sum_y += y;
+        r->sum_n += n;
+        r->sum_yy += y * y;
+        r->sum_nn += n * n;
+        r->sum_yn += y * n;
+    }
+    r->start = series->count;
+}
+
+// Stimatore rapporto del tempo di risposta medio dai cicli i.i.d.: r = somma Y / somma N, con varianza
+// s^2 = somma (Y - r N)^2 / (n - 1) e semiampiezza t * s / (media N * sqrt(n)) (Lavenberg, Crane e Iglehart)
+double ratio_estimate(regenerative_cycles *r, double *half_width) {
+    long n = r->cycles;
+    double ratio = r->sum_y / r->sum_n;
+    double s2 = (r->sum_yy - 2 * ratio * r->sum_yn + ratio * ratio * r->sum_nn) / (n - 1);
+    double mean_n = r->sum_n / n;
+    *half_width = confidence_half_width(fmax(s2, 0) / (n * mean_n * mean_n), n - 1);
+    return ratio;
+}
+
+// Stima in un solo passaggio il parametro di varianza sigma^2 = lim n * Var(media) della serie x, divisa in batch di m
+// osservazioni (quelle oltre l'ultima batch completa vengono scartate). Lo stimatore è uno tra:
+//  - ESTIMATOR_BM: batch means non sovrapposte, b - 1 gradi di libertà
+//  - ESTIMATOR_OBM: overlapping batch means di Meketon e Schmeiser, tutte le n - m + 1 finestre di m osservazioni
+//    consecutive, circa 1.5 (b - 1) gradi di libertà
+//  - ESTIMATOR_STS: area delle serie temporali standardizzate di Schruben con peso costante sqrt(12), b gradi di libertà
+// Restituisce anche la media della serie e, in dof, i gradi di libertà per l'intervallo di confidenza
+double variance_parameter(double x[], long n, long m, int estimator, double *mean, double *dof) {
+    long b = n / m;
+    n = b * m;
+    accumulator means = {0};  // Medie delle batch, o delle finestre per OBM
+    double total = 0;
+    double area = 0;
+
+    if (estimator == ESTIMATOR_OBM) {
+        double window = 0;
+        for (long i = 0; i < n; i++) {
+            total += x[i];
+            window += x[i];
+            if (i >= m) {
+                window -= x[i - m];
+            }
+            if (i >= m - 1) {
+                acc_add(&means, window / m);
+            }
+        }
+    } else {
+        for (long j = 0; j < b; j++) {
+            double sum = 0;
+            double partials = 0;  // Somma delle somme parziali S_k della batch
+            for (long k = 0; k < m; k++) {
+                sum += x[j * m + k];
+                partials += sum;
+            }
+            total += sum;
+            acc_add(&means, sum / m);
+            double a = sqrt(12.0) * (sum / m * m * (m + 1) / 2 - partials) / (m * sqrt(m));
+            area += a * a;
+        }
+    }
+    *mean = total / n;
+
+    // Somma dei quadrati degli scarti delle medie dalla media della serie
+    double squares = means.sum + means.n * (means.mean - *mean) * (means.mean - *mean);
+    switch (estimator) {
+        case ESTIMATOR_OBM:
+            *dof = 1.5 * (b - 1);
+            return (double)n * m * squares / ((n - m + 1.0) * (n - m));
+        case ESTIMATOR_STS:
+            *dof = b;
+            return area / b;
+        default:
+            *dof = b - 1;
+            return m * squares / (b - 1);
+    }
+}
+
+// Punto di troncamento della regola MSER-m di White: le osservazioni vengono raggruppate in medie di m e si sceglie il
+// numero d di medie iniziali da scartare che minimizza la varianza campionaria delle restanti divisa per il loro numero,
+// cercando d nella prima metà della serie. Ritorna il numero di osservazioni da scartare, d * m
+long mser_truncation(double x[], long n, int m) {
+    long k = n / m;
+    if (k < 2) {
+        return 0;
+    }
+    double *z = malloc(k * sizeof(double));
+    if (z == NULL) {
+        handle_error("malloc");
+    }
+    for (long j = 0; j < k; j++) {
+        z[j] = 0;
+        for (int i = 0; i < m; i++) {
+            z[j] += x[j * m + i];
+        }
+        z[j] /= m;
+    }
+
+    // Le somme delle medie da d in poi si accumulano scorrendo la serie all'indietro
+    double sum = 0;
+    double squares = 0;
+    double best_value = INFINITY;
+    long best = 0;
+    for (long d = k - 1; d >= 0; d--) {
+        sum += z[d];
+        squares += z[d] * z[d];
+        if (d > k / 2) {
+            continue;
+        }
+        double len = k - d;
+        double value = (squares - sum * sum / len) / (len * len);
+        if (value <= best_value) {
+            best_value = value;
+            best = d;
+        }
+    }
+    free(z);
+    return best * m;
+}
+
+// Voce del file di configurazione: nome "sezione.chiave", tipo ('d' double, 'i' int, 'l' long, 's' stringa), posizione
+// del campo in model_parameters e numero di valori, separati da spazi o virgole. Per le stringhe count è la dimensione del campo
+typedef struct {
+    char *name;
+    char type;
+    size_t offset;
+    int count;
+} parameter_entry;
+
+static const parameter_entry parameter_table[] = {
+    {"model.lambda", 'd', offsetof(model_parameters, lambda), 3},
+    {"model.time_slot", 'i', offsetof(model_parameters, time_slot), 3},
+    {"model.service", 'd', offsetof(model_parameters, service), NUM_BLOCKS},
+    {"model.p_exit_temp", 'd', offsetof(model_parameters, p_exit_temp), 1},
+    {"model.p_ticket_buy", 'd', offsetof(model_parameters, p_ticket_buy), 1},
+    {"model.p_ticket_gate", 'd', offsetof(model_parameters, p_ticket_gate), 1},
+    {"model.p_season_gate", 'd', offsetof(model_parameters, p_season_gate), 1},
+    {"model.monthly_cost", 'd', offsetof(model_parameters, monthly_cost), NUM_BLOCKS},
+    {"staffing.slot0", 'i', offsetof(model_parameters, staffing.slot_config[0]), NUM_BLOCKS},
+    {"staffing.slot1", 'i', offsetof(model_parameters, staffing.slot_config[1]), NUM_BLOCKS},
+    {"staffing.slot2", 'i', offsetof(model_parameters, staffing.slot_config[2]), NUM_BLOCKS},
+    {"run.seed_finite", 'l', offsetof(model_parameters, seed_finite), 1},
+    {"run.seed_infinite", 'l', offsetof(model_parameters, seed_infinite), 1},
+    {"run.repetitions", 'i', offsetof(model_parameters, repetitions), 1},
+    {"run.batch_b", 'i', offsetof(model_parameters, batch_b), 1},
+    {"run.batch_k", 'i', offsetof(model_parameters, batch_k), 1},
+    {"run.batch_b_min", 'i', offsetof(model_parameters, batch_b_min), 1},
+    {"run.batch_b_max", 'i', offsetof(model_parameters, batch_b_max), 1},
+    {"run.batch_acf", 'd', offsetof(model_parameters, batch_acf), 1},
+    {"output.dir", 's', offsetof(model_parameters, output_dir), PATH_LENGTH},
+};
+
+// Riempie i parametri con i valori predefiniti di config.h. Il piano dei serventi predefinito è quello di init_config()
+void default_parameters(model_parameters *p, network_configuration *staffing) {
+    *p = (model_parameters){
+        .lambda = {LAMBDA_1, LAMBDA_2, LAMBDA_3},
+        .time_slot = {TIME_SLOT_1, TIME_SLOT_2, TIME_SLOT_3},
+        .service = {SERV_TEMPERATURE_CTRL, SERV_TICKET_BUY, SERV_SEASON_GATE, SERV_TICKET_GATE, SERV_GREEN_PASS},
+        .p_exit_temp = P_EXIT_TEMP,
+        .p_ticket_buy = P_TICKET_BUY,
+        .p_ticket_gate = P_TICKET_GATE,
+        .p_season_gate = P_SEASON_GATE,
+        .monthly_cost = {CM_TEMPERATURE_CTRL_SERVER, CM_TICKET_BUY_SERVER, CM_SEASON_GATE_SERVER, CM_TICKET_GATE_SERVER, CM_GREEN_PASS_SERVER},
+        .staffing = *staffing,
+        .seed_finite = SEED_FINITE,
+        .seed_infinite = SEED_INFINITE,
+        .repetitions = NUM_REPETITIONS,
+        .batch_b = BATCH_B,
+        .batch_k = BATCH_K,
+        .batch_b_min = BATCH_B_MIN,
+        .batch_b_max = BATCH_B_MAX,
+        .batch_acf = BATCH_ACF,
+        .output_dir = OUTPUT_DIR,
+    };
+}
+
+// Assegna al parametro name il valore value, letto dal file di configurazione o da riga di comando.
+// Ritorna false se il parametro non esiste o se il valore non è valido
+bool set_parameter(model_parameters *p, char *name, char *value) {
+    for (size_t i = 0; i < sizeof(parameter_table) / sizeof(parameter_table[0]); i++) {
+        const parameter_entry *e = &parameter_table[i];
+        if (strcmp(e->name, name) != 0) {
+            continue;
+        }
+        char *field = (char *)p + e->offset;
+        if (e->type == 's') {
+            size_t len = strlen(value);
+            if (len == 0 || len >= (size_t)e->count) {
+                return false;
+            }
+            memcpy(field, value, len + 1);
+            return true;
+        }
+
+        char *s = value;
+        for (int j = 0; j < e->count; j++) {
+            char *end;
+            errno = 0;
+            if (e->type == 'd') {
+                ((double *)field)[j] = strtod(s, &end);
+            } else {
+                long v = strtol(s, &end, 10);
+                if (e->type == 'i' && (v < INT_MIN || v > INT_MAX)) {
+                    return false;
+                }
+                if (e->type == 'i') {
+                    ((int *)field)[j] = (int)v;
+                } else {
+                    ((long *)field)[j] = v;
+                }
+            }
+            if (end == s || errno != 0) {
+                return false;
+            }
+            s = end;
+            while (isspace((unsigned char)*s) || *s == ',') {
+                s++;
+            }
+        }
+        return *s == '\0';
+    }
+    return false;
+}
+
+// Toglie gli spazi iniziali e finali di una stringa modificabile
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+    *end = '\0';
+    return s;
+}
+
+// Legge un file di configurazione in formato INI: righe "chiave = valore" raggruppate nelle sezioni [model], [staffing],
+// [run] e [output], commenti introdotti da # o ;. Le chiavi assenti mantengono il valore che avevano
+void load_parameters(model_parameters *p, char *path) {
+    FILE *fpt = fopen(path, "r");
+    if (fpt == NULL) {
+        handle_error(path);
+    }
+    char line[1024];
+    char section[64] = "";
+    int n = 0;
+    while (fgets(line, sizeof(line), fpt) != NULL) {
+        n++;
+        line[strcspn(line, "#;\n")] = '\0';
+        char *s = trim(line);
+        if (*s == '\0') {
+            continue;
+        }
+        size_t len = strlen(s);
+        if (*s == '[' && s[len - 1] == ']' && len - 2 < sizeof(section)) {
+            s[len - 1] = '\0';
+            strcpy(section, trim(s + 1));
+            continue;
+        }
+        char *eq = strchr(s, '=');
+        char name[128];
+        if (eq != NULL) {
+            *eq = '\0';
+            snprintf(name, sizeof(name), "%s%s%s", section, *section ? "." : "", trim(s));
+        }
+        if (eq == NULL || !set_parameter(p, name, trim(eq + 1))) {
+            printf("%s:%d: invalid parameter or value\n", path, n);
+            exit(EXIT_FAILURE);
+        }
+    }
+    fclose(fpt);
+}
+
+// Applica una sostituzione "sezione.chiave=valore" passata da riga di comando, ritorna false se non è valida
+bool override_parameter(model_parameters *p, char *arg) {
+    char name[128];
+    char *eq = strchr(arg, '=');
+    if (eq == NULL || (size_t)(eq - arg) >= sizeof(name)) {
+        return false;
+    }
+    memcpy(name, arg, eq - arg);
+    name[eq - arg] = '\0';
+    return set_parameter(p, name, eq + 1);
+}
+
+// Controlla la coerenza dei parametri, stampando il primo errore trovato
+bool check_parameters(model_parameters *p) {
+    char *error = NULL;
+    for (int i = 0; i < 3; i++) {
+        if (p->lambda[i] <= 0 || p->time_slot[i] <= 0) {
+            error = "model.lambda and model.time_slot must be positive";
+        }
+        for (int j = 0; j < NUM_BLOCKS; j++) {
+            if (p->staffing.slot_config[i][j] < 0 || p->staffing.slot_config[i][j] > MAX_SERVERS) {
+                error = "staffing must be between 0 and MAX_SERVERS";
+            }
+        }
+    }
+    for (int j = 0; j < NUM_BLOCKS; j++) {
+        if (p->service[j] <= 0 || p->monthly_cost[j] < 0) {
+            error = "model.service must be positive and model.monthly_cost non-negative";
+        }
+    }
+    double routing = p->p_exit_temp + p->p_ticket_buy + p->p_ticket_gate + p->p_season_gate;
+    if (p->p_exit_temp < 0 || p->p_ticket_buy < 0 || p->p_ticket_gate < 0 || p->p_season_gate < 0 || fabs(routing - 100) > 1e-6) {
+        error = "routing percentages must be non-negative and sum to 100";
+    }
+    if (p->seed_finite <= 0 || p->seed_infinite <= 0) {
+        error = "seeds must be positive";
+    }
+    if (p->repetitions < 1 || p->repetitions > NUM_REPETITIONS) {
+        error = "run.repetitions must be between 1 and NUM_REPETITIONS";
+    }
+    if (p->batch_b < 1 || p->batch_k < 2 || p->batch_k > BATCH_K || p->batch_k % 2 != 0) {
+        error = "run.batch_b must be positive, run.batch_k even and between 2 and BATCH_K";
+    }
+    if (p->batch_b_min < 1 || p->batch_b_max < p->batch_b_min || p->batch_acf <= 0 || p->batch_acf > 1) {
+        error = "run.batch_b_min must be positive, run.batch_b_max at least run.batch_b_min and run.batch_acf in (0, 1]";
+    }
+    if (error != NULL) {
+        printf("Invalid configuration: %s\n", error);
+    }
+    return error == NULL;
+}
+
+// Crea, se non esistono, la cartella dei risultati e le sue sottocartelle finite e infinite
+void make_output_dirs(char *dir) {
+    char path[PATH_LENGTH + 16];
+    char *subdirs[] = {"", "/finite", "/infinite"};
+    for (int i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "%s%s", dir, subdirs[i]);
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            handle_error(path);
+        }
+    }
+}
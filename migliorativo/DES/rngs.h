@@ -9,11 +9,53 @@
 #if !defined( _RNGS_ )
 #define _RNGS_
 
+#define STREAMS      256  /* # of streams, DON'T CHANGE THIS VALUE              */
+#define REPLICATIONS 128  /* # of disjoint replications, DON'T CHANGE THIS VALUE */
+
+#define REPLICATION_STREAMS 8          /* streams planted disjoint by PlantReplicationSeeds   */
+#define RNG_STREAM_JUMP    8367782UL   /* Lehmer: states between streams planted by PlantSeeds */
+#define RNG_SUBSTREAM_JUMP 1048576UL   /* Lehmer: states between substreams, 2^20              */
+
+#if RNG_PHILOX
+#include <stdint.h>
+
+typedef struct {
+  uint32_t           key[2];   /* seed and stream index                */
+  uint32_t           high[2];  /* substream, high half of the counter  */
+  unsigned long long block;    /* next block, low half of the counter  */
+  uint32_t           out[4];   /* outputs of the last block            */
+  int                avail;    /* outputs of out not yet returned      */
+} rng_t;
+#else
+#define RNG_BLOCK 64          /* states computed at a time by rng_random */
+
+typedef struct {
+  long               x;                 /* current state, 0 < x < 2^31 - 1    */
+  long               ahead[RNG_BLOCK];  /* next states of the stream          */
+  int                avail;             /* states of ahead not yet returned   */
+  unsigned long long drawn;             /* states computed since placement    */
+} rng_t;
+#endif
+
+typedef struct {
+  rng_t seed[STREAMS]; /* current state of each stream   */
+  int   stream;        /* stream index, 0 is the default */
+  int   initialized;   /* test for stream initialization */
+} rngs_state;
+
+double rng_random(rng_t *r);
+void   rng_jump(rng_t *r, unsigned long long n);
+void   rng_stream(rng_t *r, long x, unsigned long long stream, unsigned long long substream);
+unsigned long long rng_draws(rng_t *r);
+
 double Random(void);
 void   PlantSeeds(long x);
+void   PlantReplicationSeeds(long x, int r);
+int    ReplicationOverlap(rngs_state *s, unsigned long long *draws);
 void   GetSeed(long *x);
 void   PutSeed(long x);
 void   SelectStream(int index);
+void   SelectState(rngs_state *s);
 void   TestRandom(void);
 
 #endif
@@ -24,5 +24,9 @@ double Lognormal(double a, double b);
 double Chisquare(long n);
 double Student(long n);
 
+double ZigguratExponential(void);
+double ZigguratNormal(void);
+void   TestZiggurat(void);
+
 #endif
 
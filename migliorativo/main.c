@@ -1,3 +1,6 @@
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,277 +16,1295 @@
 
 // Function Prototypes
 // --------------------------------------------------------
-double getArrival(double current);
+double getArrival(sim_context *ctx, double current);
 double getService(enum block_types type, int stream);
-void process_arrival();
-void process_completion(compl completion);
-void init_blocks();
-void activate_servers();
-void deactivate_servers();
-void update_network();
-void init_config();
-void enqueue_balancing(server *s, struct job *j);
-void finite_horizon_simulation(int stop_time, int repetitions);
-void finite_horizon_run(int stop, int repetition);
-void infinite_horizon_simulation(int stop);
-void infinite_horizon_batch(int stop, int repetition, int k);
-void end_servers();
-void clear_environment();
-void write_rt_csv_finite();
-void write_rt_csv_infinite();
-void init_config();
-void print_results_finite();
-void print_results_infinite();
-void init_network(int rep);
-void set_time_slot(int rep);
-void reset_statistics();
+void process_arrival(sim_context *ctx);
+void process_completion(sim_context *ctx, compl completion);
+void enqueue(sim_context *ctx, server *s, double arrival, double entry);
+server *findShorterServer(sim_context *ctx, struct block b);
+void init_blocks(sim_context *ctx);
+void activate_servers(sim_context *ctx, int block);
+void deactivate_servers(sim_context *ctx, int block);
+void update_network(sim_context *ctx);
+void finite_horizon_simulation(sim_context *ctx, int stop_time, int repetitions);
+void finite_horizon_run(sim_context *ctx, int stop, int repetition);
+void infinite_horizon_simulation(sim_context *ctx, int stop);
+void infinite_horizon_batch(sim_context *ctx, int stop, int repetition, int k);
+void end_servers(sim_context *ctx);
+void clear_environment(sim_context *ctx);
+void write_rt_csv_finite(sim_context *ctx);
+void write_rt_csv_infinite(sim_context *ctx, int slot);
+void init_config(network_configuration *config);
+void print_results_finite(sim_context *ctx);
+void print_results_infinite(sim_context *ctx, int slot);
+void init_network(sim_context *ctx, int rep);
+void set_time_slot(sim_context *ctx, int rep);
+void reset_statistics(sim_context *ctx);
+void load_balance(sim_context *ctx, int block);
+void print_ploss(sim_context *ctx);
+sim_context *create_context(long seed);
+void run_replication_pool(replication_pool *pool);
+void *replication_worker(void *arg);
+void advance_prefix(replication_pool *pool);
+void write_summary_finite(replication_pool *pool);
+void accumulate_batch(sim_context *ctx, int k);
+void merge_batches(sim_context *ctx);
+void write_summary_infinite(sim_context *ctx, int slot);
+void print_sojourn_estimate(sim_context *ctx);
+bool check_regeneration(int num_slot);
+void clear_sojourns(sim_context *ctx);
+long mser_warm_up(sim_context *ctx, int slot, rngs_state *start);
+void start_slot(sim_context *ctx, int slot);
+void seed_stationary(sim_context *ctx, int slot);
+void warm_up(sim_context *ctx, long max_arrivals, long max_exits);
+void infinite_horizon_run(sim_context *ctx, int slot, slot_pool *pool);
+void infinite_horizon_all(long seed);
+void *slot_worker(void *arg);
+void print_results_all(slot_pool *pool);
+void search_simulation(long seed, int slot);
+void search_slot(long seed, int slot, candidate *best);
+bool add_neighbor(search_history *history, candidate list[], int *count, int servers[], int bound[], int slot, double max_cost);
+candidate *find_candidate(search_history *history, int servers[]);
+void record_candidates(search_history *history, candidate list[], int count);
+void evaluate_candidates(long seed, int slot, candidate list[], int count);
+void *search_worker(void *arg);
+void evaluate_candidate(sim_context *ctx, int slot, candidate *c);
+void print_candidate(char *label, candidate *c);
+void analytic_ascent(int slot, int servers[], int *screened);
+double qos_violation(double response_time, double loss);
+void analytic_solution(sim_context *ctx, int slot);
+void compare_simulation(long seed);
+void run_contenders(selection_pool *pool, int first_rep, int last_rep);
+void *selection_worker(void *arg);
+int init_candidates(network_configuration candidates[]);
+void destroy_context(sim_context *ctx);
+void run_simulation(void);
+void check_overlap(sim_context *ctx, int repetition);
+void test_utilization(void);
 // ---------------------------------------------------------
 
-network_configuration config;
-struct clock_t clock;                          // Mantiene le informazioni sul clock di simulazione
-struct block blocks[NUM_BLOCKS];               // Mantiene lo stato dei singoli blocchi della rete
-sorted_completions global_sorted_completions;  // Tiene in una lista ordinata tutti i completamenti nella rete cosi da ottenere il prossimo in O(log(N))
-network_status global_network_status;          // Tiene lo stato complessivo della rete
 static const sorted_completions empty_sorted;
 static const network_status empty_network;
 
-double arrival_rate;
-double lambdas[] = {LAMBDA_1, LAMBDA_2, LAMBDA_3};
-int completed;
-int dropped;
-int bypassed;
-bool slot_switched[3];
-
-int stop_simulation = TIME_SLOT_1 + TIME_SLOT_2 + TIME_SLOT_3;
-int streamID;  // Stream da selezionare per generare il tempo di servizio
+int stop_simulation;  // Durata della giornata, somma delle fasce di params
 int num_slot;
 char *simulation_mode;
-FILE *finite_csv;
-
-double repetitions_costs[NUM_REPETITIONS];
-double response_times[] = {0, 0, 0};
-double statistics[NUM_REPETITIONS][3];
-double infinite_statistics[200000];
-double global_means_p[BATCH_K][NUM_BLOCKS];
-double global_means_p_fin[NUM_REPETITIONS][3][NUM_BLOCKS];
-double global_loss[BATCH_K];
+int num_threads = 1;  // Thread su cui distribuire le repliche ad orizzonte finito (-j N)
+double precision = 0;  // Precisione relativa a cui fermare le repliche ad orizzonte finito (-p P), 0 le esegue tutte
+int estimator = ESTIMATOR_BM;  // Stimatore della varianza dei tempi di risposta ad orizzonte infinito (-e BM/OBM/STS/REG)
+char *estimator_names[] = {"BM", "OBM", "STS", "REG"};
+bool delete_warm_up = false;  // Scarta prima delle batch il transitorio iniziale trovato con MSER-5 (-w MSER)
+bool stationary_start = false;  // Parte ad orizzonte infinito dalle popolazioni stazionarie M/M/c dello slot (-i STATIONARY)
 // ------------------------------------------------------------------------------------------------
 
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        printf("Usage: ./simulate-migliorativo <FINITE/INFINITE/TEST> <TIME_SLOT>\n");
+    bool valid = argc >= 3 && argc % 2 == 1;
+    char *config_files[argc];  // File di configurazione (-c FILE), eseguiti uno dopo l'altro
+    char *overrides[argc];     // Sostituzioni dei parametri (-s sezione.chiave=valore), applicate a tutti i file
+    int num_config_files = 0;
+    int num_overrides = 0;
+    for (int i = 3; valid && i < argc; i += 2) {
+        if (strcmp(argv[i], "-j") == 0) {
+            num_threads = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-p") == 0) {
+            precision = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "-e") == 0) {
+            estimator = -1;
+            for (int e = ESTIMATOR_BM; e <= ESTIMATOR_REG; e++) {
+                if (strcmp(argv[i + 1], estimator_names[e]) == 0) {
+                    estimator = e;
+                }
+            }
+            valid = estimator >= 0;
+        } else if (strcmp(argv[i], "-w") == 0) {
+            delete_warm_up = strcmp(argv[i + 1], "MSER") == 0;
+            valid = delete_warm_up || strcmp(argv[i + 1], "NONE") == 0;
+        } else if (strcmp(argv[i], "-i") == 0) {
+            stationary_start = strcmp(argv[i + 1], "STATIONARY") == 0;
+            valid = stationary_start || strcmp(argv[i + 1], "EMPTY") == 0;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            config_files[num_config_files++] = argv[i + 1];
+        } else if (strcmp(argv[i], "-s") == 0) {
+            overrides[num_overrides++] = argv[i + 1];
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        printf("Usage: ./simulate-migliorativo <FINITE/INFINITE/SEARCH/ANALYTIC/COMPARE/TEST> <TIME_SLOT/ALL> [-j THREADS] [-p PRECISION] [-e BM/OBM/STS/REG] [-w NONE/MSER] [-i EMPTY/STATIONARY] [-c CONFIG]... [-s SECTION.KEY=VALUE]...\n");
         exit(0);
     }
     simulation_mode = argv[1];
-    num_slot = atoi(argv[2]);
+    if (str_compare(argv[2], "ALL") == 0) {
+        num_slot = ALL_SLOTS;
+    } else {
+        num_slot = atoi(argv[2]);
+    }
+    if (num_threads < 1) {
+        printf("Specify at least 1 thread\n");
+        exit(0);
+    }
+    if (precision < 0) {
+        printf("Specify a non-negative precision\n");
+        exit(0);
+    }
+
+    // Le configurazioni vengono tutte lette e controllate prima di iniziare, così un errore in una di esse non interrompe
+    // a metà una serie di simulazioni
+    int num_runs = (num_config_files > 0) ? num_config_files : 1;
+    model_parameters *runs = malloc(num_runs * sizeof(model_parameters));
+    if (runs == NULL) {
+        handle_error("malloc");
+    }
+    network_configuration staffing;
+    init_config(&staffing);
+    for (int r = 0; r < num_runs; r++) {
+        default_parameters(&runs[r], &staffing);
+        if (num_config_files > 0) {
+            load_parameters(&runs[r], config_files[r]);
+        }
+        for (int i = 0; i < num_overrides; i++) {
+            if (!override_parameter(&runs[r], overrides[i])) {
+                printf("Invalid parameter %s\n", overrides[i]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (!check_parameters(&runs[r])) {
+            exit(EXIT_FAILURE);
+        }
+        params = runs[r];
+        if (estimator == ESTIMATOR_REG && str_compare(simulation_mode, "INFINITE") == 0 && !check_regeneration(num_slot)) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int r = 0; r < num_runs; r++) {
+        params = runs[r];
+        if (num_config_files > 0) {
+            printf("\n==== Configuration %s ====\n", config_files[r]);
+        }
+        run_simulation();
+    }
+    free(runs);
+}
+
+// Esegue la modalità scelta con i parametri correnti
+void run_simulation(void) {
+    stop_simulation = params.time_slot[0] + params.time_slot[1] + params.time_slot[2];
+    make_output_dirs(params.output_dir);
 
     if (str_compare(simulation_mode, "FINITE") == 0) {
-        PlantSeeds(521312312);
-        finite_horizon_simulation(stop_simulation, NUM_REPETITIONS);
+        sim_context *ctx = create_context(params.seed_finite);
+        finite_horizon_simulation(ctx, stop_simulation, params.repetitions);
+        destroy_context(ctx);
 
     } else if (str_compare(simulation_mode, "INFINITE") == 0) {
-        PlantSeeds(231232132);
-        infinite_horizon_simulation(num_slot);
+        if (num_slot == ALL_SLOTS) {
+            infinite_horizon_all(params.seed_infinite);
+        } else {
+            sim_context *ctx = create_context(params.seed_infinite);
+            infinite_horizon_simulation(ctx, num_slot);
+            destroy_context(ctx);
+        }
+
+    } else if (str_compare(simulation_mode, "SEARCH") == 0) {
+        search_simulation(params.seed_infinite, num_slot);
+
+    } else if (str_compare(simulation_mode, "ANALYTIC") == 0) {
+        sim_context *ctx = create_context(params.seed_infinite);
+        analytic_solution(ctx, num_slot);
+        destroy_context(ctx);
+
+    } else if (str_compare(simulation_mode, "COMPARE") == 0) {
+        compare_simulation(params.seed_finite);
+
+    } else if (str_compare(simulation_mode, "TEST") == 0) {
+        // Verifica del generatore e, se compilati con make ziggurat, dei generatori a ziggurat
+        TestRandom();
+        TestZiggurat();
+        test_utilization();
+
     } else {
-        printf("Specify mode FINITE/INFINITE or TEST\n");
+        printf("Specify mode FINITE/INFINITE/SEARCH/ANALYTIC/COMPARE or TEST\n");
         exit(0);
     }
 }
 
+// Alloca un contesto di simulazione vuoto, con tutti gli stream del suo generatore inizializzati a partire dal seed
+sim_context *create_context(long seed) {
+    sim_context *ctx = calloc(1, sizeof(sim_context));
+    if (ctx == NULL) {
+        handle_error("calloc");
+    }
+    ctx->jobs.free_list = NO_JOB;
+    ctx->seed = seed;
+    SelectState(&ctx->rng);
+    PlantSeeds(seed);
+    return ctx;
+}
+
+// Libera il contesto e tutta la memoria dinamica che possiede (code dei server e slab del job pool)
+void destroy_context(sim_context *ctx) {
+    for (int block_type = 0; block_type < NUM_BLOCKS; block_type++) {
+        for (int j = 0; j < MAX_SERVERS; j++) {
+            free_queue(&ctx->network.server_list[block_type][j].queue);
+        }
+    }
+    free_job_pool(&ctx->jobs);
+    free(ctx->sojourns.values);
+    free(ctx);
+}
+
 // Stampa a schermo delle percentuali di perdita del blocco 4
-void print_ploss() {
-    double loss_perc = (float)blocks[GREEN_PASS].total_bypassed / (float)blocks[GREEN_PASS].total_arrivals;
+void print_ploss(sim_context *ctx) {
+    double loss_perc = (float)ctx->blocks[GREEN_PASS].total_bypassed / (float)ctx->blocks[GREEN_PASS].total_arrivals;
     printf("P_LOSS: %f\n", loss_perc);
 }
 
-// Esegue le ripetizioni di singole run a orizzonte finito
-void finite_horizon_simulation(int stop_time, int repetitions) {
-    printf("\n\n==== Finite Horizon Simulation | sim_time %d | #repetitions #%d ====", stop_simulation, NUM_REPETITIONS);
-    init_config();
-    print_configuration(&config);
-
-    char filename[100];
-    snprintf(filename, 100, "results/finite/continuos_finite.csv");
+// Esegue le ripetizioni di singole run a orizzonte finito, distribuendole su num_threads thread.
+// I risultati sono gli stessi per ogni numero di thread
+void finite_horizon_simulation(sim_context *ctx, int stop_time, int repetitions) {
+    printf("\n\n==== Finite Horizon Simulation | sim_time %d | #repetitions #%d ====", stop_simulation, params.repetitions);
+    ctx->config = params.staffing;
+    print_configuration(&ctx->config);
+
+    replication_pool pool = {.results = ctx, .stop_time = stop_time, .repetitions = repetitions, .stop_at = repetitions};
+    pool.outputs = calloc(repetitions, sizeof(replication_output));
+    if (pool.outputs == NULL) {
+        handle_error("calloc");
+    }
+    run_replication_pool(&pool);
+    ctx->repetitions = pool.stop_at;
 
-    finite_csv = open_csv(filename);
+    // Le righe del continuo vengono scritte in ordine di replica, come in un'esecuzione sequenziale
+    char filename[PATH_LENGTH + 64];
+    snprintf(filename, sizeof(filename), "%s/finite/continuos_finite.csv", params.output_dir);
+    FILE *csv = open_csv(filename);
+    for (int r = 0; r < repetitions; r++) {
+        if (r < ctx->repetitions) {
+            fwrite(pool.outputs[r].csv, 1, pool.outputs[r].csv_len, csv);
+        }
+        free(pool.outputs[r].csv);
+    }
+    fclose(csv);
 
+    // Le stampe delle repliche non si sovrappongono tra thread diversi
     for (int r = 0; r < repetitions; r++) {
-        finite_horizon_run(stop_time, r);
+        if (r < ctx->repetitions) {
+            fwrite(pool.outputs[r].report, 1, pool.outputs[r].report_len, stdout);
+        }
+        free(pool.outputs[r].report);
+    }
+    free(pool.outputs);
+
+    write_rt_csv_finite(ctx);
+    print_results_finite(ctx);
+    printf("\n");
+    if (precision > 0) {
+        printf("SEQUENTIAL STOP: %d of %d replications (relative precision %g, confidence %.0f%%)\n", ctx->repetitions, repetitions, precision,
+               100.0 * CONFIDENCE);
+    }
+    for (int s = 0; s < 3; s++) {
+        printf("Slot #%d response time: %f +/- %f\n", s, pool.rt[s].mean, acc_half_width(&pool.rt[s]));
+    }
+    write_summary_finite(&pool);
+    printf("\nJOB POOL HIGH-WATER MARK: %ld jobs (%u slabs)\n", pool.max_high_water, pool.max_slabs);
+}
+
+// Esegue tutte le repliche del pool su num_threads thread, al più uno per replica
+void run_replication_pool(replication_pool *pool) {
+    pthread_mutex_init(&pool->lock, NULL);
+
+    int threads = (num_threads < pool->repetitions) ? num_threads : pool->repetitions;
+    pthread_t workers[threads];
+    for (int t = 0; t < threads; t++) {
+        int err = pthread_create(&workers[t], NULL, replication_worker, pool);
+        if (err != 0) {
+            errno = err;
+            handle_error("pthread_create");
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+}
+
+// Thread del pool: esegue repliche finché ce ne sono, su un proprio contesto, e ne copia i risultati nel contesto del pool
+void *replication_worker(void *arg) {
+    replication_pool *pool = arg;
+    sim_context *results = pool->results;
+    sim_context *ctx = create_context(results->seed);
+    ctx->config = results->config;
+
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        int r = pool->next++;
+        bool stop = r >= pool->stop_at;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop) {
+            break;
+        }
+
+        replication_output *out = &pool->outputs[r];
+        ctx->finite_csv = open_memstream(&out->csv, &out->csv_len);
+        ctx->report = open_memstream(&out->report, &out->report_len);
+        finite_horizon_run(ctx, pool->stop_time, r);
         if (r == 0 && strcmp(simulation_mode, "FINITE") == 0) {
-            print_p_on_csv(&global_network_status, clock.current, 2);
+            print_p_on_csv(&ctx->network, ctx->clock.current, 2);
         }
-        clear_environment();
+        fclose(ctx->finite_csv);
+        fclose(ctx->report);
+
+        // Ogni replica scrive soltanto le proprie righe, non serve sincronizzazione
+        memcpy(results->statistics[r], ctx->statistics[r], sizeof(results->statistics[r]));
+        memcpy(results->global_means_p_fin[r], ctx->global_means_p_fin[r], sizeof(results->global_means_p_fin[r]));
+        results->repetitions_costs[r] = ctx->repetitions_costs[r];
+        clear_environment(ctx);
+
+        pthread_mutex_lock(&pool->lock);
+        print_percentage(pool->done, pool->repetitions, pool->done - 1);
+        pool->done++;
+        pool->finished[r] = true;
+        advance_prefix(pool);
+        pthread_mutex_unlock(&pool->lock);
+    }
 
-        print_percentage(r, repetitions, r - 1);
+    pthread_mutex_lock(&pool->lock);
+    if (ctx->jobs.max_high_water > pool->max_high_water) {
+        pool->max_high_water = ctx->jobs.max_high_water;
+    }
+    if (ctx->jobs.num_slabs > pool->max_slabs) {
+        pool->max_slabs = ctx->jobs.num_slabs;
     }
+    pthread_mutex_unlock(&pool->lock);
+    destroy_context(ctx);
+    return NULL;
+}
 
-    fclose(finite_csv);
-    write_rt_csv_finite();
-    print_results_finite();
+// Accumula le repliche terminate in ordine di indice, così il punto di arresto non dipende da quale thread finisce prima.
+// Con -p ci si ferma appena la semiampiezza dell'intervallo è sotto la precisione relativa in tutti gli slot. Va chiamata col lock preso
+void advance_prefix(replication_pool *pool) {
+    while (pool->prefix < pool->stop_at && pool->finished[pool->prefix]) {
+        for (int s = 0; s < 3; s++) {
+            acc_add(&pool->rt[s], pool->results->statistics[pool->prefix][s]);
+            for (int j = 0; j < NUM_BLOCKS; j++) {
+                acc_add(&pool->utilization[s][j], pool->results->global_means_p_fin[pool->prefix][s][j]);
+            }
+        }
+        acc_add(&pool->cost, pool->results->repetitions_costs[pool->prefix]);
+        pool->prefix++;
+        if (precision == 0 || pool->prefix < MIN_REPETITIONS) {
+            continue;
+        }
+        bool reached = true;
+        for (int s = 0; s < 3; s++) {
+            reached = reached && acc_half_width(&pool->rt[s]) <= precision * fabs(pool->rt[s].mean);
+        }
+        if (reached) {
+            pool->stop_at = pool->prefix;
+        }
+    }
+}
+
+// Scrive il riepilogo delle metriche delle repliche ad orizzonte finito, una riga per metrica
+void write_summary_finite(replication_pool *pool) {
+    char filename[PATH_LENGTH + 64];
+    snprintf(filename, sizeof(filename), "%s/finite/summary_finite.csv", params.output_dir);
+    FILE *csv = open_summary(filename);
+    char metric[100];
+    for (int s = 0; s < 3; s++) {
+        snprintf(metric, 100, "rt_slot%d", s);
+        append_summary(csv, metric, &pool->rt[s]);
+    }
+    append_summary(csv, "cost", &pool->cost);
+    for (int s = 0; s < 3; s++) {
+        for (int j = 0; j < NUM_BLOCKS; j++) {
+            snprintf(metric, 100, "u_%s_slot%d", stringFromEnum(j), s);
+            append_summary(csv, metric, &pool->utilization[s][j]);
+        }
+    }
+    fclose(csv);
 }
 
 // Esegue una simulazione ad orizzonte infinito tramite il metodo delle batch means
-void infinite_horizon_simulation(int slot) {
-    printf("\n\n==== Infinite Horizon Simulation for slot %d | #batch %d====", slot, BATCH_K);
-    init_config();
-    print_configuration(&config);
-    arrival_rate = lambdas[slot];
-    int b = BATCH_B;
-    clear_environment();
-    init_network(0);
-    global_network_status.time_slot = slot;
-    update_network();
-    for (int k = 0; k < BATCH_K; k++) {
-        infinite_horizon_batch(slot, b, k);
-        print_percentage(k, BATCH_K, k - 1);
-    }
-    write_rt_csv_infinite(slot);
-    end_servers();
-    print_results_infinite(slot);
+void infinite_horizon_simulation(sim_context *ctx, int slot) {
+    printf("\n\n==== Infinite Horizon Simulation for slot %d | #batch %d====", slot, params.batch_k);
+    ctx->config = params.staffing;
+    print_configuration(&ctx->config);
+    infinite_horizon_run(ctx, slot, NULL);
+    print_results_infinite(ctx, slot);
 }
 
-// Esegue una singola run di simulazione ad orizzonte finito
-void finite_horizon_run(int stop_time, int repetition) {
-    init_network(0);
-    int n = 1;
+// Esegue le params.batch_k batch di uno slot e ne scrive i csv. Si parte da batch di params.batch_b_min arrivi: finché l'autocorrelazione
+// di lag 1 dei tempi di risposta delle batch resta sopra params.batch_acf, le batch adiacenti vengono fuse a coppie e la simulazione
+// prosegue con batch di dimensione doppia fino ad averne di nuovo params.batch_k. Con pool != NULL la barra di avanzamento è quella condivisa dai tre slot
+void infinite_horizon_run(sim_context *ctx, int slot, slot_pool *pool) {
+    ctx->arrival_rate = params.lambda[slot];
+    int b = params.batch_b_min;
+    rngs_state start = ctx->rng;
+    start_slot(ctx, slot);
+    ctx->warm_up_jobs = delete_warm_up ? mser_warm_up(ctx, slot, &start) : 0;
+    ctx->warm_up_time = ctx->clock.current;
+    ctx->collect_sojourns = estimator != ESTIMATOR_BM;
+    clear_sojourns(ctx);
+    ctx->batch_rt = (accumulator){0};
+    ctx->batch_loss = (accumulator){0};
+    memset(ctx->batch_utilization, 0, sizeof(ctx->batch_utilization));
+    int k = 0;
+    while (k < params.batch_k) {
+        infinite_horizon_batch(ctx, slot, b, k);
+        accumulate_batch(ctx, k);
+        if (pool == NULL) {
+            print_percentage(k, params.batch_k, k - 1);
+        } else {
+            pthread_mutex_lock(&pool->lock);
+            print_percentage(pool->done, 3 * params.batch_k, pool->done - 1);
+            pool->done++;
+            pthread_mutex_unlock(&pool->lock);
+        }
+        k++;
+
+        if (k == params.batch_k && b < params.batch_b_max && acc_autocorrelation(&ctx->batch_rt, 1) >= params.batch_acf) {
+            merge_batches(ctx);
+            b *= 2;
+            k = params.batch_k / 2;
+            if (pool != NULL) {
+                pthread_mutex_lock(&pool->lock);
+                pool->done -= params.batch_k / 2;
+                pthread_mutex_unlock(&pool->lock);
+            }
+        }
+    }
+    ctx->batch_b = b;
+    ctx->collect_sojourns = false;
+    write_rt_csv_infinite(ctx, slot);
+    write_summary_infinite(ctx, slot);
+    end_servers(ctx);
+}
 
-    while (clock.arrival <= stop_time) {
-        set_time_slot(repetition);
-        compl *nextCompletion = &global_sorted_completions.sorted_list[0];
-        server *nextCompletionServer = nextCompletion->server;
+// Porta la rete nello stato iniziale dello slot: vuota oppure, con -i STATIONARY, popolata dalla distribuzione stazionaria
+void start_slot(sim_context *ctx, int slot) {
+    clear_environment(ctx);
+    init_network(ctx, 0);
+    ctx->network.time_slot = slot;
+    update_network(ctx);
+    if (stationary_start) {
+        seed_stationary(ctx, slot);
+    }
+}
+
+// Cerca con MSER-5 la fine del transitorio iniziale sui tempi di risposta dei job di una run pilota di MSER_PILOT arrivi.
+// Poi riparte da start, lo stato del generatore prima di start_slot, e simula soltanto il transitorio, così le batch
+// iniziano subito dopo senza ripetere la run pilota. Ritorna il numero di job scartati
+long mser_warm_up(sim_context *ctx, int slot, rngs_state *start) {
+    ctx->collect_sojourns = true;
+    clear_sojourns(ctx);
+    warm_up(ctx, MSER_PILOT, LONG_MAX);
+    long n = ctx->sojourns.count;
+    long truncation = mser_truncation(ctx->sojourns.values, n, MSER_BATCH);
+    ctx->warm_up_short = truncation >= (n / MSER_BATCH / 2) * MSER_BATCH;
+    if (ctx->warm_up_short) {
+        truncation = 0;  // Nessun punto stazionario nella run pilota: non scarto nulla piuttosto che partire da uno stato congestionato
+    }
+
+    ctx->rng = *start;
+    start_slot(ctx, slot);
+    clear_sojourns(ctx);
+    warm_up(ctx, LONG_MAX, truncation);
+    reset_statistics(ctx);
+    ctx->collect_sojourns = false;
+    clear_sojourns(ctx);
+    return truncation;
+}
 
-        clock.next = min(nextCompletion->value, clock.arrival);
+// Fa avanzare la simulazione finché non sono arrivati max_arrivals job o non ne sono usciti max_exits. A differenza delle
+// batch non svuota il sistema e non calcola statistiche
+void warm_up(sim_context *ctx, long max_arrivals, long max_exits) {
+    long n = 0;
+    while (n < max_arrivals && ctx->sojourns.count < max_exits) {
+        compl *nextCompletion = getNextCompletion(&ctx->completions);
+        ctx->clock.next = min(nextCompletion->value, ctx->clock.arrival);  // Ottengo il prossimo evento
+        ctx->clock.current = ctx->clock.next;
+        if (ctx->clock.current == ctx->clock.arrival) {
+            process_arrival(ctx);
+            n++;
+        } else {
+            process_completion(ctx, *nextCompletion);
+        }
+    }
+}
+
+// Popola la rete appena avviata con un numero di job per blocco estratto dalla distribuzione stazionaria dello slot: M/M/c
+// con arrivi lambda * visite per i blocchi con coda, M/M/c/c per il green pass. Ai job in servizio viene generato un tempo
+// di servizio nuovo, che per l'assenza di memoria dell'esponenziale ha la stessa distribuzione del residuo. Il loro ingresso
+// nel sistema non è noto (NAN), quindi i loro tempi di risposta non entrano nella serie dei job
+void seed_stationary(sim_context *ctx, int slot) {
+    double *services = params.service;
+    double visits[NUM_BLOCKS];
+    visit_ratios(visits);
+    SelectState(&ctx->rng);
+
+    for (int j = 0; j < NUM_BLOCKS; j++) {
+        double a = params.lambda[slot] * visits[j] * services[j];
+        double u = rng_random(&ctx->rng.seed[STATIONARY_STREAM]);
+        int n = stationary_population(ctx->config.slot_config[slot][j], a, j == GREEN_PASS, u);
+        for (int i = 0; i < n; i++) {
+            SelectStream(STATIONARY_STREAM);  // Spareggio della coda più corta
+            server *s = findShorterServer(ctx, ctx->blocks[j]);
+            s->jobInTotal++;
+            ctx->in_system++;
+            update_length_index(&ctx->network, s);
+            if (j == GREEN_PASS) {
+                ctx->blocks[j].jobInBlock++;
+                s->entry = NAN;
+            } else {
+                enqueue(ctx, s, ctx->clock.current, NAN);
+            }
+            if (s->status == IDLE) {
+                double serviceTime = getService(j, s->stream);
+                compl c = {s, ctx->clock.current + serviceTime};
+                s->status = BUSY;
+                update_idle_index(&ctx->network, s);
+                s->sum.service += serviceTime;
+                s->sum.served++;
+                insertCompletion(&ctx->completions, c);
+            } else {
+                s->jobInQueue++;
+                ctx->blocks[j].jobInQueue++;
+            }
+        }
+    }
+}
+
+// Aggiunge le metriche della batch k appena conclusa agli accumulatori del contesto
+void accumulate_batch(sim_context *ctx, int k) {
+    acc_add(&ctx->batch_rt, ctx->infinite_statistics[k]);
+    acc_add(&ctx->batch_loss, ctx->global_loss[k]);
+    for (int i = 0; i < NUM_BLOCKS; i++) {
+        acc_add(&ctx->batch_utilization[i], ctx->global_means_p[k][i]);
+    }
+}
+
+// Fonde a coppie le params.batch_k batch adiacenti in params.batch_k / 2 batch di dimensione doppia: avendo lo stesso numero di arrivi,
+// la metrica di una batch fusa è la media di quelle delle due batch di partenza. Gli accumulatori ripartono dalle batch fuse
+void merge_batches(sim_context *ctx) {
+    for (int k = 0; k < params.batch_k / 2; k++) {
+        ctx->infinite_statistics[k] = (ctx->infinite_statistics[2 * k] + ctx->infinite_statistics[2 * k + 1]) / 2;
+        ctx->global_loss[k] = (ctx->global_loss[2 * k] + ctx->global_loss[2 * k + 1]) / 2;
         for (int i = 0; i < NUM_BLOCKS; i++) {
-            if (i == GREEN_PASS) {
-                blocks[i].area.node += (clock.next - clock.current) * blocks[GREEN_PASS].jobInBlock;
+            ctx->global_means_p[k][i] = (ctx->global_means_p[2 * k][i] + ctx->global_means_p[2 * k + 1][i]) / 2;
+        }
+    }
+
+    ctx->batch_rt = (accumulator){0};
+    ctx->batch_loss = (accumulator){0};
+    memset(ctx->batch_utilization, 0, sizeof(ctx->batch_utilization));
+    for (int k = 0; k < params.batch_k / 2; k++) {
+        accumulate_batch(ctx, k);
+    }
+}
+
+// Scrive il riepilogo delle batch means di uno slot, una riga per metrica
+void write_summary_infinite(sim_context *ctx, int slot) {
+    char filename[PATH_LENGTH + 64];
+    snprintf(filename, sizeof(filename), "%s/infinite/summary_infinite_slot_%d.csv", params.output_dir, slot);
+    FILE *csv = open_summary(filename);
+    append_summary(csv, "rt", &ctx->batch_rt);
+    append_summary(csv, "loss", &ctx->batch_loss);
+    char metric[100];
+    for (int i = 0; i < NUM_BLOCKS; i++) {
+        snprintf(metric, 100, "u_%s", stringFromEnum(i));
+        append_summary(csv, metric, &ctx->batch_utilization[i]);
+    }
+    fclose(csv);
+}
+
+// Esegue in parallelo le simulazioni ad orizzonte infinito dei tre slot, ognuna su un proprio thread e contesto.
+// Ogni contesto parte dallo stesso seed di un'esecuzione con slot singolo, quindi i risultati coincidono
+void infinite_horizon_all(long seed) {
+    printf("\n\n==== Infinite Horizon Simulation for all slots | #batch %d====", params.batch_k);
+    slot_pool pool = {.done = 0};
+    pthread_mutex_init(&pool.lock, NULL);
+    for (int slot = 0; slot < 3; slot++) {
+        pool.contexts[slot] = create_context(seed);
+        pool.contexts[slot]->config = params.staffing;
+    }
+    print_configuration(&pool.contexts[0]->config);
+
+    slot_task tasks[3];
+    pthread_t workers[3];
+    for (int slot = 0; slot < 3; slot++) {
+        tasks[slot] = (slot_task){.pool = &pool, .slot = slot};
+        int err = pthread_create(&workers[slot], NULL, slot_worker, &tasks[slot]);
+        if (err != 0) {
+            errno = err;
+            handle_error("pthread_create");
+        }
+    }
+    for (int slot = 0; slot < 3; slot++) {
+        pthread_join(workers[slot], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+
+    for (int slot = 0; slot < 3; slot++) {
+        print_results_infinite(pool.contexts[slot], slot);
+    }
+    print_results_all(&pool);
+    for (int slot = 0; slot < 3; slot++) {
+        destroy_context(pool.contexts[slot]);
+    }
+}
+
+// Thread della modalità ALL: esegue le batch means di un singolo slot sul contesto che gli è stato assegnato
+void *slot_worker(void *arg) {
+    slot_task *task = arg;
+    sim_context *ctx = task->pool->contexts[task->slot];
+    SelectState(&ctx->rng);
+    infinite_horizon_run(ctx, task->slot, task->pool);
+    return NULL;
+}
+
+// Cerca per uno slot, o per tutti con ALL, la configurazione di costo minimo che rispetta i vincoli di QoS
+// e stampa il piano dei serventi nello stesso formato degli array di init_config()
+void search_simulation(long seed, int slot) {
+    printf("\n\n==== Configuration Search | QoS response time %.1f s, green pass loss %.2f | #threads %d ====\n", (double)QOS_RESPONSE_TIME, (double)QOS_GREEN_PASS_LOSS, num_threads);
+    int first = (slot == ALL_SLOTS) ? 0 : slot;
+    int last = (slot == ALL_SLOTS) ? 2 : slot;
+    candidate plan[3];
+    for (int s = first; s <= last; s++) {
+        search_slot(seed, s, &plan[s]);
+    }
+
+    print_line();
+    double total = 0;
+    for (int s = first; s <= last; s++) {
+        candidate *c = &plan[s];
+        printf("int slot%d_ottima[] = {%d, %d, %d, %d, %d};  // cost %f, rt %f, loss %f%s\n", s, c->servers[0], c->servers[1], c->servers[2],
+               c->servers[3], c->servers[4], c->cost, c->response_time, c->loss, c->feasible ? "" : " [QoS non rispettata]");
+        total += c->cost;
+    }
+    printf("\nTOTAL CONFIGURATION COST: %f\n", total);
+}
+
+// Cerca la configurazione di costo minimo di uno slot che rispetta i vincoli di QoS. Parte dalla stima del modello analitico e aggiunge
+// un server alla volta finché i vincoli non sono rispettati (salita), poi toglie o sposta server finché il costo scende (discesa).
+// Ogni passo valuta in parallelo i vicini, scartando quelli instabili, già valutati o dominati da configurazioni note
+void search_slot(long seed, int slot, candidate *best) {
+    int bound[NUM_BLOCKS];
+    stability_bound(params.lambda[slot], bound);
+    search_history history = {.count = 0};
+    candidate list[NUM_BLOCKS * NUM_BLOCKS];
+    int count = 0;
+
+    printf("\nSlot #%d", slot);
+    int start[NUM_BLOCKS];
+    memcpy(start, bound, sizeof(start));
+    analytic_ascent(slot, start, &history.screened);
+    add_neighbor(&history, list, &count, start, bound, slot, INFINITY);
+    if (count == 0) {
+        // Il punto di partenza supera MAX_SERVERS in qualche blocco: nessuna configurazione ammessa è stabile
+        printf("\nNessuna configurazione stabile con al massimo %d server per blocco", MAX_SERVERS);
+        *best = (candidate){.cost = configuration_cost(start, params.time_slot[slot]), .response_time = INFINITY, .loss = 1, .feasible = false};
+        memcpy(best->servers, start, sizeof(best->servers));
+        return;
+    }
+    evaluate_candidates(seed, slot, list, count);
+    record_candidates(&history, list, count);
+    candidate current = list[0];
+    print_candidate("start", &current);
+
+    // Salita: aggiunge il server che riduce di più la violazione dei vincoli per unità di costo
+    while (!current.feasible) {
+        candidate *neighbors[NUM_BLOCKS];
+        count = 0;
+        for (int j = 0; j < NUM_BLOCKS; j++) {
+            int servers[NUM_BLOCKS];
+            memcpy(servers, current.servers, sizeof(servers));
+            servers[j]++;
+            add_neighbor(&history, list, &count, servers, bound, slot, INFINITY);
+        }
+        evaluate_candidates(seed, slot, list, count);
+        record_candidates(&history, list, count);
+
+        int found = 0;
+        for (int j = 0; j < NUM_BLOCKS; j++) {
+            int servers[NUM_BLOCKS];
+            memcpy(servers, current.servers, sizeof(servers));
+            servers[j]++;
+            candidate *c = find_candidate(&history, servers);
+            if (c != NULL) {
+                neighbors[found++] = c;
             }
-            for (int j = 0; j < MAX_SERVERS; j++) {  // Non posso fare il ciclo su num_online_servers altrimenti non aggiorno le statistiche di quelli con need_resched
-                server *s = &global_network_status.server_list[i][j];
+        }
+        if (found == 0) {
+            printf("\nNessuna configurazione con al massimo %d server per blocco rispetta i vincoli", MAX_SERVERS);
+            break;
+        }
 
-                if (s->jobInTotal > 0 && s->used) {
-                    s->area.node += (clock.next - clock.current) * s->jobInTotal;
-                    s->area.queue += (clock.next - clock.current) * s->jobInQueue;
-                    s->area.service += (clock.next - clock.current);
+        double violation = qos_violation(current.response_time, current.loss);
+        candidate *next = NULL;
+        double best_score = 0;
+        double min_violation = INFINITY;
+        candidate *least_violating = NULL;
+        for (int i = 0; i < found; i++) {
+            candidate *c = neighbors[i];
+            double v = qos_violation(c->response_time, c->loss);
+            double score = (violation - v) / (c->cost - current.cost);
+            if (score > best_score) {
+                best_score = score;
+                next = c;
+            }
+            if (v < min_violation) {
+                min_violation = v;
+                least_violating = c;
+            }
+        }
+        current = (next != NULL) ? *next : *least_violating;
+        print_candidate("add", &current);
+    }
+    *best = current;
+
+    // Discesa: sceglie il vicino ammissibile più economico tra quelli con un server in meno o con un server spostato
+    while (best->feasible) {
+        count = 0;
+        for (int i = 0; i < NUM_BLOCKS; i++) {
+            for (int j = -1; j < NUM_BLOCKS; j++) {
+                if (j == i) {
+                    continue;
+                }
+                int servers[NUM_BLOCKS];
+                memcpy(servers, best->servers, sizeof(servers));
+                servers[i]--;
+                if (j >= 0) {
+                    servers[j]++;
                 }
+                add_neighbor(&history, list, &count, servers, bound, slot, best->cost);
+            }
+        }
+        evaluate_candidates(seed, slot, list, count);
+        record_candidates(&history, list, count);
+
+        candidate *next = NULL;
+        for (int i = 0; i < count; i++) {
+            if (list[i].feasible && (next == NULL || list[i].cost < next->cost)) {
+                next = &list[i];
             }
         }
-        clock.current = clock.next;  // Avanzamento del clock al valore del prossimo evento
+        if (next == NULL) {
+            break;
+        }
+        *best = *next;
+        print_candidate("move", best);
+    }
+    printf("\n...%d configurations screened analytically, %d simulated, %d pruned\n", history.screened, history.count, history.pruned);
+    free(history.items);
+}
+
+// Salita sul modello analitico: partendo dalla configurazione data aggiunge il server che riduce di più la violazione dei
+// vincoli per unità di costo, finché la soluzione analitica li rispetta. Ogni passo costa microsecondi invece di una simulazione
+void analytic_ascent(int slot, int servers[], int *screened) {
+    double durations[] = {params.time_slot[0], params.time_slot[1], params.time_slot[2]};
+    network_configuration config = {0};
+    analytic_network sol;
+    memcpy(config.slot_config[slot], servers, sizeof(config.slot_config[slot]));
+    solve_analytic(&config, slot, &sol);
+    (*screened)++;
+
+    while (qos_violation(sol.response_time, sol.blocks[GREEN_PASS].loss) > 0) {
+        double violation = qos_violation(sol.response_time, sol.blocks[GREEN_PASS].loss);
+        double cost = configuration_cost(config.slot_config[slot], durations[slot]);
+        int next = -1;
+        double best_score = -INFINITY;
+        for (int j = 0; j < NUM_BLOCKS; j++) {
+            if (config.slot_config[slot][j] >= MAX_SERVERS) {
+                continue;
+            }
+            config.slot_config[slot][j]++;
+            analytic_network neighbor;
+            solve_analytic(&config, slot, &neighbor);
+            (*screened)++;
+            double score = (violation - qos_violation(neighbor.response_time, neighbor.blocks[GREEN_PASS].loss)) / (configuration_cost(config.slot_config[slot], durations[slot]) - cost);
+            config.slot_config[slot][j]--;
+            if (score > best_score) {
+                best_score = score;
+                next = j;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        config.slot_config[slot][next]++;
+        solve_analytic(&config, slot, &sol);
+    }
+    memcpy(servers, config.slot_config[slot], sizeof(config.slot_config[slot]));
+}
+
+// Misura di quanto una configurazione viola i vincoli di QoS, 0 se li rispetta entrambi
+double qos_violation(double response_time, double loss) {
+    return fmax(response_time / QOS_RESPONSE_TIME - 1, 0) + fmax(loss / QOS_GREEN_PASS_LOSS - 1, 0);
+}
+
+// Aggiunge un vicino alla lista da valutare, a meno che non sia già stato valutato o che possa essere scartato senza simularlo:
+// instabile, non più economico di max_cost, oppure con meno server di una configurazione non ammissibile (stesso green pass)
+bool add_neighbor(search_history *history, candidate list[], int *count, int servers[], int bound[], int slot, double max_cost) {
+    double durations[] = {params.time_slot[0], params.time_slot[1], params.time_slot[2]};
+    if (find_candidate(history, servers) != NULL) {
+        return false;
+    }
+    for (int i = 0; i < *count; i++) {
+        if (memcmp(list[i].servers, servers, sizeof(list[i].servers)) == 0) {
+            return false;
+        }
+    }
+    for (int j = 0; j < NUM_BLOCKS; j++) {
+        if (servers[j] > MAX_SERVERS) {
+            return false;
+        }
+        if (servers[j] < bound[j]) {
+            history->pruned++;
+            return false;
+        }
+    }
+    double cost = configuration_cost(servers, durations[slot]);
+    if (cost >= max_cost) {
+        history->pruned++;
+        return false;
+    }
+    for (int i = 0; i < history->count; i++) {
+        candidate *c = &history->items[i];
+        if (c->feasible || c->servers[GREEN_PASS] != servers[GREEN_PASS]) {
+            continue;
+        }
+        bool dominated = true;
+        for (int j = 0; j < NUM_BLOCKS && dominated; j++) {
+            dominated = servers[j] <= c->servers[j];
+        }
+        if (dominated) {
+            history->pruned++;
+            return false;
+        }
+    }
+
+    candidate *c = &list[(*count)++];
+    memcpy(c->servers, servers, sizeof(c->servers));
+    c->cost = cost;
+    return true;
+}
 
-        if (clock.current == clock.arrival) {
-            process_arrival();
+// Ritorna il candidato già valutato con la configurazione specificata, NULL se non è mai stato simulato
+candidate *find_candidate(search_history *history, int servers[]) {
+    for (int i = 0; i < history->count; i++) {
+        if (memcmp(history->items[i].servers, servers, sizeof(history->items[i].servers)) == 0) {
+            return &history->items[i];
+        }
+    }
+    return NULL;
+}
+
+// Aggiunge allo storico della ricerca i candidati appena valutati
+void record_candidates(search_history *history, candidate list[], int count) {
+    if (history->count + count > history->capacity) {
+        history->capacity = (history->capacity + count) * 2;
+        history->items = realloc(history->items, history->capacity * sizeof(candidate));
+        if (history->items == NULL) {
+            handle_error("realloc");
+        }
+    }
+    memcpy(&history->items[history->count], list, count * sizeof(candidate));
+    history->count += count;
+}
+
+// Valuta i candidati distribuendoli su num_threads thread
+void evaluate_candidates(long seed, int slot, candidate list[], int count) {
+    search_pool pool = {.candidates = list, .count = count, .slot = slot, .seed = seed};
+    pthread_mutex_init(&pool.lock, NULL);
+    int threads = (num_threads < count) ? num_threads : count;
+    pthread_t workers[threads];
+    for (int t = 0; t < threads; t++) {
+        int err = pthread_create(&workers[t], NULL, search_worker, &pool);
+        if (err != 0) {
+            errno = err;
+            handle_error("pthread_create");
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+}
+
+// Thread della ricerca: valuta candidati finché ce ne sono, su un proprio contesto
+void *search_worker(void *arg) {
+    search_pool *pool = arg;
+    sim_context *ctx = create_context(pool->seed);
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        int i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->count) {
+            break;
+        }
+        evaluate_candidate(ctx, pool->slot, &pool->candidates[i]);
+    }
+    destroy_context(ctx);
+    return NULL;
+}
+
+// Valuta un candidato con le batch means dello slot, senza scrivere csv. Il generatore riparte sempre dal seed,
+// così tutti i candidati sono confrontati sugli stessi numeri casuali e il risultato non dipende dal thread
+void evaluate_candidate(sim_context *ctx, int slot, candidate *c) {
+    for (int j = 0; j < NUM_BLOCKS; j++) {
+        ctx->config.slot_config[slot][j] = c->servers[j];
+    }
+    SelectState(&ctx->rng);
+    PlantSeeds(ctx->seed);
+    ctx->arrival_rate = params.lambda[slot];
+    clear_environment(ctx);
+    init_network(ctx, 0);
+    ctx->clock.batch_current = START;
+    ctx->network.time_slot = slot;
+    update_network(ctx);
+    for (int k = 0; k < params.batch_k; k++) {
+        infinite_horizon_batch(ctx, slot, params.batch_b, k);
+    }
+
+    double rt = 0;
+    double loss = 0;
+    for (int k = 0; k < params.batch_k; k++) {
+        rt += ctx->infinite_statistics[k];
+        loss += ctx->global_loss[k];
+    }
+    c->response_time = rt / params.batch_k;
+    c->loss = loss / params.batch_k;
+    c->feasible = c->response_time <= QOS_RESPONSE_TIME && c->loss <= QOS_GREEN_PASS_LOSS;
+}
+
+// Stampa un passo della ricerca
+void print_candidate(char *label, candidate *c) {
+    printf("\n...%-5s {%d, %d, %d, %d, %d} cost %f, rt %f, loss %f", label, c->servers[0], c->servers[1], c->servers[2], c->servers[3],
+           c->servers[4], c->cost, c->response_time, c->loss);
+}
+
+// Stampa la soluzione analitica del piano dei serventi dei parametri per uno slot, o per tutti con ALL
+void analytic_solution(sim_context *ctx, int slot) {
+    double durations[] = {params.time_slot[0], params.time_slot[1], params.time_slot[2]};
+    printf("\n\n==== Analytic Solution (Erlang-C / Erlang-B) ====");
+    ctx->config = params.staffing;
+    print_configuration(&ctx->config);
+    int first = (slot == ALL_SLOTS) ? 0 : slot;
+    int last = (slot == ALL_SLOTS) ? 2 : slot;
+    for (int s = first; s <= last; s++) {
+        analytic_network sol;
+        solve_analytic(&ctx->config, s, &sol);
+        print_line();
+        printf("Slot #%d\n", s);
+        printf("%-20s%8s%12s%12s%12s%12s%12s\n", "", "SERVERS", "LAMBDA", "RHO", "WAIT", "RESPONSE", "LOSS");
+        for (int j = 0; j < NUM_BLOCKS; j++) {
+            analytic_block *b = &sol.blocks[j];
+            printf("%-20s%8d%12f%12f%12f%12f%12f\n", stringFromEnum(j), b->servers, b->lambda, b->rho, b->wait, b->response, b->loss);
+        }
+        printf("\nRESPONSE TIME: %f%s", sol.response_time, sol.stable ? "" : " [instabile]");
+        printf("\nCONFIGURATION COST: %f\n", configuration_cost(ctx->config.slot_config[s], durations[s]));
+    }
+}
+
+// Confronta le configurazioni di init_candidates() ad orizzonte finito con la procedura sequenziale di Kim e Nelson:
+// dopo KN_FIRST_STAGE repliche elimina a ogni nuova replica i candidati con tempo di risposta medio chiaramente peggiore,
+// finché ne resta uno. La configurazione scelta ha tempo di risposta minimo con probabilità almeno 1 - KN_ALPHA,
+// se la migliore è più bassa delle altre di almeno KN_DELTA
+void compare_simulation(long seed) {
+    contender contenders[MAX_CONTENDERS];
+    network_configuration candidates[MAX_CONTENDERS];
+    int k = init_candidates(candidates);
+    // Con meno repliche di KN_FIRST_STAGE il primo stadio usa tutte quelle disponibili, ne servono almeno 2 per le varianze
+    int n0 = (params.repetitions < KN_FIRST_STAGE) ? params.repetitions : KN_FIRST_STAGE;
+    if (n0 < 2) {
+        printf("COMPARE needs at least 2 replications (run.repetitions)\n");
+        return;
+    }
+    printf("\n\n==== Configuration Comparison (KN) | #candidates %d | PCS %.2f | delta %.2f s | n0 %d ====\n", k, 1 - KN_ALPHA, KN_DELTA, n0);
+
+    selection_pool pool = {.contenders = contenders, .num_alive = k, .seed = seed};
+    for (int i = 0; i < k; i++) {
+        contenders[i].config = candidates[i];
+        contenders[i].eliminated = 0;
+        pool.alive[i] = i;
+    }
+
+    // Primo stadio: n0 repliche per tutti, da cui le varianze campionarie delle differenze a coppie
+    run_contenders(&pool, 0, n0);
+    double eta = 0.5 * (pow(2 * KN_ALPHA / (k - 1), -2.0 / (n0 - 1)) - 1);
+    double h2 = 2 * eta * (n0 - 1);
+    double s2[MAX_CONTENDERS][MAX_CONTENDERS];
+    for (int i = 0; i < k; i++) {
+        for (int l = 0; l < k; l++) {
+            double mean = 0;
+            for (int r = 0; r < n0; r++) {
+                mean += contenders[i].response_time[r] - contenders[l].response_time[r];
+            }
+            mean /= n0;
+            double var = 0;
+            for (int r = 0; r < n0; r++) {
+                double diff = contenders[i].response_time[r] - contenders[l].response_time[r] - mean;
+                var += diff * diff;
+            }
+            s2[i][l] = var / (n0 - 1);
+        }
+    }
+
+    // Screening: i viene eliminato se la sua media supera quella di un altro candidato in gara più del margine W_il(r)
+    int r = n0;
+    while (true) {
+        double means[MAX_CONTENDERS];
+        for (int a = 0; a < pool.num_alive; a++) {
+            int i = pool.alive[a];
+            means[i] = 0;
+            for (int q = 0; q < r; q++) {
+                means[i] += contenders[i].response_time[q];
+            }
+            means[i] /= r;
+        }
+        // Ogni candidato viene confrontato con tutti quelli in gara all'inizio dello stadio, anche se eliminati nello stesso stadio
+        int old_alive[MAX_CONTENDERS];
+        int num_old = pool.num_alive;
+        memcpy(old_alive, pool.alive, sizeof(old_alive));
+        int survivors = 0;
+        for (int a = 0; a < num_old; a++) {
+            int i = old_alive[a];
+            for (int b = 0; b < num_old; b++) {
+                int l = old_alive[b];
+                double w = fmax(0, KN_DELTA / (2 * r) * (h2 * s2[i][l] / (KN_DELTA * KN_DELTA) - r));
+                if (l != i && means[i] > means[l] + w) {
+                    contenders[i].eliminated = r;
+                    break;
+                }
+            }
+            if (contenders[i].eliminated == 0) {
+                pool.alive[survivors++] = i;
+            }
+        }
+        pool.num_alive = survivors;
+        if (pool.num_alive <= 1 || r >= params.repetitions) {
+            break;
+        }
+        run_contenders(&pool, r, r + 1);
+        r++;
+    }
+
+    // Se le repliche finiscono con più candidati in gara si sceglie la media minima, senza garanzia
+    int best = pool.alive[0];
+    for (int a = 1; a < pool.num_alive; a++) {
+        int i = pool.alive[a];
+        double mean_i = 0, mean_best = 0;
+        for (int q = 0; q < r; q++) {
+            mean_i += contenders[i].response_time[q];
+            mean_best += contenders[best].response_time[q];
+        }
+        if (mean_i < mean_best) {
+            best = i;
+        }
+    }
+
+    print_line();
+    int total = 0;
+    for (int i = 0; i < k; i++) {
+        int reps = (contenders[i].eliminated > 0) ? contenders[i].eliminated : r;
+        double rt = 0, cost = 0;
+        for (int q = 0; q < reps; q++) {
+            rt += contenders[i].response_time[q];
+            cost += contenders[i].cost[q];
+        }
+        total += reps;
+        printf("\nCandidate #%d", i);
+        for (int s = 0; s < 3; s++) {
+            int *c = contenders[i].config.slot_config[s];
+            printf(" {%d, %d, %d, %d, %d}", c[0], c[1], c[2], c[3], c[4]);
+        }
+        printf("\n...replications %d, mean response time %f, mean cost %f%s", reps, rt / reps, cost / reps, (i == best) ? " [BEST]" : "");
+    }
+    printf("\n\nREPLICATIONS: %d of %d (%.1f%%)\n", total, k * params.repetitions, 100.0 * total / (k * params.repetitions));
+    if (pool.num_alive == 1) {
+        printf("Candidate #%d is the best with probability >= %.2f (indifference zone %.2f s)\n", best, 1 - KN_ALPHA, KN_DELTA);
+    } else {
+        printf("%d candidates still in contention after %d replications: no selection guarantee\n", pool.num_alive, params.repetitions);
+    }
+}
+
+// Esegue le repliche [first_rep, last_rep) di tutti i candidati in gara, distribuendole su num_threads thread
+void run_contenders(selection_pool *pool, int first_rep, int last_rep) {
+    pool->first_rep = first_rep;
+    pool->last_rep = last_rep;
+    pool->next = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    int work = pool->num_alive * (last_rep - first_rep);
+    int threads = (num_threads < work) ? num_threads : work;
+    pthread_t workers[threads];
+    for (int t = 0; t < threads; t++) {
+        int err = pthread_create(&workers[t], NULL, selection_worker, pool);
+        if (err != 0) {
+            errno = err;
+            handle_error("pthread_create");
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+}
+
+// Thread della selezione: esegue coppie (candidato, replica) finché ce ne sono, su un proprio contesto
+void *selection_worker(void *arg) {
+    selection_pool *pool = arg;
+    int reps = pool->last_rep - pool->first_rep;
+    sim_context *ctx = create_context(pool->seed);
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        int w = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (w >= pool->num_alive * reps) {
+            break;
+        }
+        contender *c = &pool->contenders[pool->alive[w / reps]];
+        int r = pool->first_rep + w % reps;
+        ctx->config = c->config;
+        finite_horizon_run(ctx, stop_simulation, r);
+        c->response_time[r] = ctx->statistics[r][2];  // A fine giornata le aree coprono tutti e tre gli slot
+        c->cost[r] = ctx->repetitions_costs[r];
+        clear_environment(ctx);
+    }
+    destroy_context(ctx);
+    return NULL;
+}
+
+// Esegue una singola run di simulazione ad orizzonte finito
+void finite_horizon_run(sim_context *ctx, int stop_time, int repetition) {
+    SelectState(&ctx->rng);
+    PlantReplicationSeeds(ctx->seed, repetition);  // Gli stream dipendono solo dall'indice della replica, non dal thread che la esegue
+    init_network(ctx, 0);
+    int n = 1;
+
+    while (ctx->clock.arrival <= stop_time) {
+        set_time_slot(ctx, repetition);
+        compl *nextCompletion = getNextCompletion(&ctx->completions);
+        server *nextCompletionServer = nextCompletion->server;
+
+        ctx->clock.next = min(nextCompletion->value, ctx->clock.arrival);
+        ctx->clock.current = ctx->clock.next;  // Avanzamento del clock al valore del prossimo evento
+
+        if (ctx->clock.current == ctx->clock.arrival) {
+            process_arrival(ctx);
         } else {
-            process_completion(*nextCompletion);
+            process_completion(ctx, *nextCompletion);
         }
-        if (clock.current >= (n - 1) * 300 && clock.current < (n)*300 && completed > 16 && clock.arrival < stop_time) {
-            calculate_statistics_clock(&global_network_status, blocks, clock.current, finite_csv);
+        if (ctx->clock.current >= (n - 1) * 300 && ctx->clock.current < (n)*300 && ctx->completed > 16 && ctx->clock.arrival < stop_time) {
+            flush_areas(&ctx->network, ctx->blocks, ctx->clock.current);
+            if (ctx->finite_csv != NULL) {  // COMPARE non scrive il continuo
+                calculate_statistics_clock(&ctx->network, ctx->blocks, ctx->clock.current, ctx->finite_csv);
+            }
             n++;
         }
     }
-    end_servers();
-    repetitions_costs[repetition] = calculate_cost(&global_network_status);
-    calculate_statistics_fin(&global_network_status, clock.current, response_times, global_means_p_fin, repetition);
+    end_servers(ctx);
+    ctx->repetitions_costs[repetition] = calculate_cost(&ctx->network);
+    flush_areas(&ctx->network, ctx->blocks, ctx->clock.current);
+    calculate_statistics_fin(&ctx->network, ctx->clock.current, ctx->response_times, ctx->global_means_p_fin, repetition);
 
     for (int i = 0; i < 3; i++) {
-        statistics[repetition][i] = response_times[i];
+        ctx->statistics[repetition][i] = ctx->response_times[i];
     }
+    check_overlap(ctx, repetition);
 }
 
 // Resetta l'ambiante di esecuzione tra due run ad orizzonte finito
-void clear_environment() {
-    global_sorted_completions = empty_sorted;
-    global_network_status = empty_network;
+void clear_environment(sim_context *ctx) {
+    ctx->completions = empty_sorted;
+    for (int block_type = 0; block_type < NUM_BLOCKS; block_type++) {
+        for (int j = 0; j < MAX_SERVERS; j++) {
+            free_queue(&ctx->network.server_list[block_type][j].queue);
+        }
+    }
+    ctx->network = empty_network;
+    reset_job_pool(&ctx->jobs);  // I job rimasti nelle code della run precedente tornano tutti disponibili
 
     for (int block_type = 0; block_type < NUM_BLOCKS; block_type++) {
         for (int j = 0; j < MAX_SERVERS; j++) {
-            if (global_network_status.server_list[block_type][j].used) {
-                global_network_status.server_list[block_type][j].area.service = 0;
-                global_network_status.server_list[block_type][j].area.node = 0;
-                global_network_status.server_list[block_type][j].area.queue = 0;
+            if (ctx->network.server_list[block_type][j].used) {
+                ctx->network.server_list[block_type][j].area.service = 0;
+                ctx->network.server_list[block_type][j].area.node = 0;
+                ctx->network.server_list[block_type][j].area.queue = 0;
             }
         }
     }
 }
 
 // Calcola il tempo online per i server al termine della simulazione
-void end_servers() {
+void end_servers(sim_context *ctx) {
     for (int j = 0; j < NUM_BLOCKS; j++) {
         for (int i = 0; i < MAX_SERVERS; i++) {
-            server *s = &global_network_status.server_list[j][i];
+            server *s = &ctx->network.server_list[j][i];
             if (s->online == ONLINE) {
-                s->time_online += (clock.current - s->last_online);
-                s->last_online = clock.current;
+                s->time_online += (ctx->clock.current - s->last_online);
+                s->last_online = ctx->clock.current;
             }
         }
     }
 }
 
 // Esegue una simulazione ad orizzonte infinito di un singolo batch
-void infinite_horizon_batch(int slot, int b, int k) {
+void infinite_horizon_batch(sim_context *ctx, int slot, int b, int k) {
     int n = 0;
     int q = 0;
-    global_network_status.time_slot = slot;
+    ctx->network.time_slot = slot;
     double old;
 
     while (true) {
-        compl *nextCompletion = &global_sorted_completions.sorted_list[0];
+        compl *nextCompletion = getNextCompletion(&ctx->completions);
         server *nextCompletionServer = nextCompletion->server;
         if (n >= b) {
-            clock.next = nextCompletion->value;  // Ottengo il prossimo evento
-            if (clock.next == INFINITY) {
+            ctx->clock.next = nextCompletion->value;  // Ottengo il prossimo evento
+            if (ctx->clock.next == INFINITY) {
                 break;
             }
         } else {
-            clock.next = min(nextCompletion->value, clock.arrival);
-        }
-        for (int i = 0; i < NUM_BLOCKS; i++) {
-            if (i == GREEN_PASS) {
-                blocks[i].area.node += (clock.next - clock.current) * blocks[GREEN_PASS].jobInBlock;
-            }
-            for (int j = 0; j < MAX_SERVERS; j++) {  // Non posso fare il ciclo su num_online_servers altrimenti non aggiorno le statistiche di quelli con need_resched
-                server *s = &global_network_status.server_list[i][j];
-
-                if (s->jobInTotal > 0 && s->used) {
-                    s->area.node += (clock.next - clock.current) * s->jobInTotal;
-                    s->area.queue += (clock.next - clock.current) * s->jobInQueue;
-                    s->area.service += (clock.next - clock.current);
-                }
-            }
+            ctx->clock.next = min(nextCompletion->value, ctx->clock.arrival);
         }
-        clock.current = clock.next;  // Avanzamento del clock al valore del prossimo evento
+        ctx->clock.current = ctx->clock.next;  // Avanzamento del clock al valore del prossimo evento
 
-        if (clock.current == clock.arrival) {
-            process_arrival();
+        if (ctx->clock.current == ctx->clock.arrival) {
+            process_arrival(ctx);
             n++;
         } else {
-            process_completion(*nextCompletion);
+            process_completion(ctx, *nextCompletion);
             q++;
         }
     }
-    calculate_statistics_inf(&global_network_status, blocks, (clock.current - clock.batch_current), infinite_statistics, k);
+    flush_areas(&ctx->network, ctx->blocks, ctx->clock.current);
+    calculate_statistics_inf(&ctx->network, ctx->blocks, (ctx->clock.current - ctx->clock.batch_current), ctx->infinite_statistics, k);
     for (int i = 0; i < NUM_BLOCKS; i++) {
         double p = 0;
         int n = 0;
         for (int j = 0; j < MAX_SERVERS; j++) {
-            server s = global_network_status.server_list[i][j];
+            server s = ctx->network.server_list[i][j];
             if (s.used == 1) {
-                p += (s.sum.service / clock.current);
+                p += (s.sum.service / ctx->clock.current);
                 n++;
             }
         }
         if (i == GREEN_PASS) {
-            double loss_perc = (float)blocks[i].total_bypassed / (float)blocks[i].total_arrivals;
-            global_loss[k] = loss_perc;
+            double loss_perc = (float)ctx->blocks[i].total_bypassed / (float)ctx->blocks[i].total_arrivals;
+            ctx->global_loss[k] = loss_perc;
         }
-        global_means_p[k][i] = p / n;
+        ctx->global_means_p[k][i] = p / n;
     }
-    reset_statistics();
+    reset_statistics(ctx);
 }
 
 // Genera un tempo di arrivo secondo la distribuzione Esponenziale
-double getArrival(double current) {
+double getArrival(sim_context *ctx, double current) {
     double arrival = current;
-    SelectStream(254);
-    arrival += Exponential(1 / arrival_rate);
+    SelectState(&ctx->rng);
+    SelectStream(ARRIVAL_STREAM);
+    arrival += Exponential(1 / ctx->arrival_rate);
     return arrival;
 }
 
@@ -293,31 +1314,33 @@ double getService(enum block_types type, int stream) {
 
     switch (type) {
         case TEMPERATURE_CTRL:
-            return Exponential(SERV_TEMPERATURE_CTRL);
+            return Exponential(params.service[TEMPERATURE_CTRL]);
         case TICKET_BUY:
-            return Exponential(SERV_TICKET_BUY);
+            return Exponential(params.service[TICKET_BUY]);
         case TICKET_GATE:
-            return Exponential(SERV_TICKET_GATE);
+            return Exponential(params.service[TICKET_GATE]);
         case SEASON_GATE:
-            return Exponential(SERV_SEASON_GATE);
+            return Exponential(params.service[SEASON_GATE]);
         case GREEN_PASS:
-            return Exponential(SERV_GREEN_PASS);
+            return Exponential(params.service[GREEN_PASS]);
         default:
             return 0;
     }
 }
 // Inizializza tutti i serventi presenti nel sistema
-void init_blocks() {
+void init_blocks(sim_context *ctx) {
     for (int block_type = 0; block_type < NUM_BLOCKS; block_type++) {
-        blocks[block_type].type = block_type;
-        blocks[block_type].jobInBlock = 0;
-        blocks[block_type].jobInQueue = 0;
-        blocks[block_type].total_arrivals = 0;
-        blocks[block_type].total_completions = 0;
-        blocks[block_type].total_bypassed = 0;
-        blocks[block_type].area.node = 0;
-        blocks[block_type].area.service = 0;
-        blocks[block_type].area.queue = 0;
+        ctx->blocks[block_type].type = block_type;
+        ctx->blocks[block_type].jobInBlock = 0;
+        ctx->blocks[block_type].jobInQueue = 0;
+        ctx->blocks[block_type].total_arrivals = 0;
+        ctx->blocks[block_type].total_completions = 0;
+        ctx->blocks[block_type].total_bypassed = 0;
+        ctx->blocks[block_type].area.node = 0;
+        ctx->blocks[block_type].area.service = 0;
+        ctx->blocks[block_type].area.queue = 0;
+        ctx->blocks[block_type].last_change = ctx->clock.current;
+        init_length_index(&ctx->network, block_type);
 
         for (int i = 0; i < MAX_SERVERS; i++) {
             server s;
@@ -326,8 +1349,9 @@ void init_blocks() {
             s.online = OFFLINE;
             s.used = NOTUSED;
             s.need_resched = false;
-            s.block = &blocks[block_type];
-            s.stream = streamID++;
+            s.compl_pos = -1;
+            s.block = &ctx->blocks[block_type];
+            s.stream = block_type;
             s.sum.served = 0;
             s.sum.service = 0.0;
             s.time_online = 0.0;
@@ -337,60 +1361,62 @@ void init_blocks() {
             s.completions = 0;
             s.arrivals = 0;
 
-            s.head_service = NULL;
-            s.tail = NULL;
+            s.queue = (job_queue){NULL, 0, 0, 0};
             s.area.node = 0;
             s.area.service = 0;
             s.area.queue = 0;
+            s.last_change = ctx->clock.current;
 
-            global_network_status.server_list[block_type][i] = s;
-
-            compl c = {&global_network_status.server_list[block_type][i], INFINITY};
-            insertSorted(&global_sorted_completions, c);
+            ctx->network.server_list[block_type][i] = s;
         }
     }
 }
 
 // Disattiva un certo numero di server per il blocco, raggiungendo il numero specificato nella configurazione
-void deactivate_servers(int block) {
+void deactivate_servers(sim_context *ctx, int block) {
     int start = 0;
-    int slot = global_network_status.time_slot;
-    start = global_network_status.num_online_servers[block];
+    int slot = ctx->network.time_slot;
+    start = ctx->network.num_online_servers[block];
 
-    for (int i = start - 1; i >= config.slot_config[slot][block]; i--) {
-        server *s = &global_network_status.server_list[block][i];
+    for (int i = start - 1; i >= ctx->config.slot_config[slot][block]; i--) {
+        server *s = &ctx->network.server_list[block][i];
 
         if (s->status == BUSY) {
             s->need_resched = true;
         } else {
             s->online = OFFLINE;
-            s->time_online += (clock.current - s->last_online);
-            s->last_online = clock.current;
+            s->time_online += (ctx->clock.current - s->last_online);
+            s->last_online = ctx->clock.current;
         }
-        global_network_status.num_online_servers[block] = config.slot_config[slot][block];
+        ctx->network.num_online_servers[block] = ctx->config.slot_config[slot][block];
+        update_idle_index(&ctx->network, s);
+        update_length_index(&ctx->network, s);
     }
 }
 
 // Attiva un certo numero di server per il blocco, raggiungendo il numero specificato nella configurazione
-void activate_servers(int block) {
+void activate_servers(sim_context *ctx, int block) {
     int start = 0;
-    int slot = global_network_status.time_slot;
+    int slot = ctx->network.time_slot;
 
-    start = global_network_status.num_online_servers[block];
-    for (int i = start; i < config.slot_config[slot][block]; i++) {
-        server *s = &global_network_status.server_list[block][i];
+    start = ctx->network.num_online_servers[block];
+    for (int i = start; i < ctx->config.slot_config[slot][block]; i++) {
+        server *s = &ctx->network.server_list[block][i];
         s->online = ONLINE;
         s->used = USED;
-        global_network_status.num_online_servers[block] = config.slot_config[slot][block];
+        s->need_resched = false;  // Se era stato disattivato mentre serviva, ora resta online anche a coda vuota
+        ctx->network.num_online_servers[block] = ctx->config.slot_config[slot][block];
+        update_idle_index(&ctx->network, s);
+        update_length_index(&ctx->network, s);
     }
 }
 
 // Gestisce il processo di load balancing delle code
-void load_balance(int block) {
-    int slot = global_network_status.time_slot;
-    int total_old = config.slot_config[slot - 1][block];
-    int total_new = config.slot_config[slot][block];
-    int total_job = blocks[block].jobInQueue;
+void load_balance(sim_context *ctx, int block) {
+    int slot = ctx->network.time_slot;
+    int total_old = ctx->config.slot_config[slot - 1][block];
+    int total_new = ctx->config.slot_config[slot][block];
+    int total_job = ctx->blocks[block].jobInQueue;
 
     if (total_job == 0) {  // Non ci sono job da ri-distribuire
         return;
@@ -398,424 +1424,531 @@ void load_balance(int block) {
 
     int only_new = total_new - total_old;
     int jobRemain = total_job / total_new;
-    server last_server;
 
-    int j = 0;
-    int destID = 0;
     int lastID = 0;
     for (int i = 0; i < total_old; i++) {
-        server *source = &global_network_status.server_list[block][i];
-        while (source->jobInQueue > jobRemain) {
-            destID = ((lastID) % (only_new)) + total_old;
-            server *destination = &global_network_status.server_list[block][destID];
-
-            struct job *tmp = source->tail->prev;
-            enqueue_balancing(destination, source->tail);  // Sposta il job in coda dal servente source nella coda del servente di destinazione
-            source->tail = tmp;
-            if (source->tail->next) {
-                source->tail->next = NULL;
-            }
+        server *source = &ctx->network.server_list[block][i];
+        int excess = source->jobInQueue - jobRemain;
+        if (excess <= 0) {
+            continue;
+        }
+
+        // I job in eccesso vanno a turno ai nuovi server: ogni destinazione riceve in blocco un segmento della coda di source
+        int dests = (excess < only_new) ? excess : only_new;
+        for (int d = 0; d < dests; d++) {
+            int moved = excess / only_new + ((d < excess % only_new) ? 1 : 0);
+            int destID = ((lastID + d) % (only_new)) + total_old;
+            server *destination = &ctx->network.server_list[block][destID];
+
+            integrate_server(source, ctx->clock.current);
+            integrate_server(destination, ctx->clock.current);
+            move_tail_jobs(&source->queue, &destination->queue, moved);  // Sposta gli ultimi job in coda dal servente source nella coda del servente di destinazione
 
-            destination->jobInTotal++;
-            destination->arrivals++;
+            destination->jobInTotal += moved;
+            destination->arrivals += moved;
+            update_length_index(&ctx->network, destination);
             if (destination->status == IDLE) {
                 double serviceTime = getService(block, destination->stream);
                 compl c = {destination, INFINITY};
-                c.value = clock.current + serviceTime;
+                c.value = ctx->clock.current + serviceTime;
                 destination->status = BUSY;
-                insertSorted(&global_sorted_completions, c);
-                blocks[block].jobInQueue--;  // Il primo job che andrà nel server IDLE APPENA ACCESSO non dovrà essere contato più come in coda, è in servizio
+                update_idle_index(&ctx->network, destination);
+                insertCompletion(&ctx->completions, c);
+                ctx->blocks[block].jobInQueue--;  // Il primo job che andrà nel server IDLE APPENA ACCESSO non dovrà essere contato più come in coda, è in servizio
+                destination->jobInQueue += moved - 1;
             } else {
-                destination->jobInQueue++;  // Il numero di job in coda nel BLOCCO non varia perchè il job appena spostato si trovava comunque nella coda di un altro servente
+                destination->jobInQueue += moved;  // Il numero di job in coda nel BLOCCO non varia perchè il job appena spostato si trovava comunque nella coda di un altro servente
             }
-            source->jobInQueue--;
-            source->jobInTotal--;
-            source->arrivals--;
-            lastID++;
+            source->jobInQueue -= moved;
+            source->jobInTotal -= moved;
+            source->arrivals -= moved;
+            update_length_index(&ctx->network, source);
         }
+        lastID += excess;
     }
 }
 
 // Aggiorna i serventi attivi al cambio di fascia, attivando o disattivando il numero necessario per ogni blocco
-void update_network() {
+void update_network(sim_context *ctx) {
     int actual, new = 0;
-    int slot = global_network_status.time_slot;
+    int slot = ctx->network.time_slot;
+    SelectState(&ctx->rng);  // L'attivazione dei server può generare nuovi tempi di servizio
 
     for (int j = 0; j < NUM_BLOCKS; j++) {
-        actual = global_network_status.num_online_servers[j];
-        new = config.slot_config[slot][j];
+        actual = ctx->network.num_online_servers[j];
+        new = ctx->config.slot_config[slot][j];
         if (actual > new) {
-            deactivate_servers(j);
+            deactivate_servers(ctx, j);
         } else if (actual < new) {
-            activate_servers(j);
+            activate_servers(ctx, j);
             if (slot != 0)
-                load_balance(j);
+                load_balance(ctx, j);
         }
     }
 }
 
 // Cambia la fascia oraria settando il tasso di arrivo ed attivando/disattivando i server necessari
-void set_time_slot(int rep) {
-    if (clock.current == START && !slot_switched[0]) {
-        global_network_status.time_slot = 0;
-        arrival_rate = LAMBDA_1;
-        slot_switched[0] = true;
-        update_network();
-    }
-    if (clock.current >= TIME_SLOT_1 && clock.current < TIME_SLOT_1 + TIME_SLOT_2 && !slot_switched[1]) {
+void set_time_slot(sim_context *ctx, int rep) {
+    if (ctx->clock.current == START && !ctx->slot_switched[0]) {
+        ctx->network.time_slot = 0;
+        ctx->arrival_rate = params.lambda[0];
+        ctx->slot_switched[0] = true;
+        update_network(ctx);
+    }
+    if (ctx->clock.current >= params.time_slot[0] && ctx->clock.current < params.time_slot[0] + params.time_slot[1] && !ctx->slot_switched[1]) {
+        flush_areas(&ctx->network, ctx->blocks, ctx->clock.current);
         if (rep == 0 && strcmp(simulation_mode, "FINITE") == 0) {
-            print_p_on_csv(&global_network_status, clock.current, global_network_status.time_slot);
+            print_p_on_csv(&ctx->network, ctx->clock.current, ctx->network.time_slot);
         }
-        calculate_statistics_fin(&global_network_status, clock.current, response_times, global_means_p_fin, rep);
-        global_network_status.time_slot = 1;
-        arrival_rate = LAMBDA_2;
-        slot_switched[1] = true;
-        update_network();
+        calculate_statistics_fin(&ctx->network, ctx->clock.current, ctx->response_times, ctx->global_means_p_fin, rep);
+        ctx->network.time_slot = 1;
+        ctx->arrival_rate = params.lambda[1];
+        ctx->slot_switched[1] = true;
+        update_network(ctx);
     }
 
-    if (clock.current >= TIME_SLOT_1 + TIME_SLOT_2 && !slot_switched[2]) {
-        calculate_statistics_fin(&global_network_status, clock.current, response_times, global_means_p_fin, rep);
+    if (ctx->clock.current >= params.time_slot[0] + params.time_slot[1] && !ctx->slot_switched[2]) {
+        flush_areas(&ctx->network, ctx->blocks, ctx->clock.current);
+        calculate_statistics_fin(&ctx->network, ctx->clock.current, ctx->response_times, ctx->global_means_p_fin, rep);
         if (rep == 0 && strcmp(simulation_mode, "FINITE") == 0) {
-            print_p_on_csv(&global_network_status, clock.current, global_network_status.time_slot);
+            print_p_on_csv(&ctx->network, ctx->clock.current, ctx->network.time_slot);
         }
 
-        global_network_status.time_slot = 2;
-        arrival_rate = LAMBDA_3;
-        slot_switched[2] = true;
-        update_network();
-        print_servers_statistics(&global_network_status, clock.current, clock.current);
+        ctx->network.time_slot = 2;
+        ctx->arrival_rate = params.lambda[2];
+        ctx->slot_switched[2] = true;
+        update_network(ctx);
+        if (ctx->report != NULL) {
+            print_servers_statistics(&ctx->network, ctx->clock.current, ctx->clock.current, ctx->report);
+        }
     }
 }
 
 // Inizializza lo stato dei blocchi del sistema
-void init_network(int rep) {
-    streamID = 0;
-    clock.current = START;
+void init_network(sim_context *ctx, int rep) {
+    ctx->clock.current = START;
     for (int i = 0; i < 3; i++) {
-        slot_switched[i] = false;
-        response_times[i] = 0;
+        ctx->slot_switched[i] = false;
+        ctx->response_times[i] = 0;
     }
 
-    init_blocks();
-    if (str_compare(simulation_mode, "FINITE") == 0) {
-        set_time_slot(rep);
+    initCompletions(&ctx->completions);
+    init_blocks(ctx);
+    // Anche TEST esegue repliche ad orizzonte finito, in test_utilization
+    if (str_compare(simulation_mode, "FINITE") == 0 || str_compare(simulation_mode, "COMPARE") == 0 || str_compare(simulation_mode, "TEST") == 0) {
+        set_time_slot(ctx, rep);
     }
 
-    completed = 0;
-    bypassed = 0;
-    dropped = 0;
-    clock.arrival = getArrival(clock.current);
-    global_sorted_completions.num_completions = 0;
+    ctx->completed = 0;
+    ctx->bypassed = 0;
+    ctx->dropped = 0;
+    ctx->in_system = 0;
+    ctx->clock.arrival = getArrival(ctx, ctx->clock.current);
 }
 
 // Inserisce un job nella coda del server specificato
-void enqueue(server *s, double arrival) {
-    struct job *j = (struct job *)malloc(sizeof(struct job));
-    if (j == NULL)
-        handle_error("malloc");
-
-    j->arrival = arrival;
-    j->next = NULL;
-
-    // Appendi alla coda se esiste, altrimenti è la testa
-    if (s->tail) {
-        j->prev = s->tail;
-        s->tail->next = j;  // aggiorno la vecchia coda e la faccio puntare a J
-    } else {
-        j->prev = NULL;
-        s->head_service = j;
-    }
-
-    s->tail = j;  // J diventa la nuova coda
-}
-
-void enqueue_balancing(server *s, struct job *j) {
-    if (s->tail != NULL) {  // Appendi alla coda se esiste, altrimenti è la testa
-        s->tail->next = j;
-        j->prev = s->tail;
-    } else {
-        s->head_service = j;
-        if (s->head_service->prev)
-            s->head_service->prev = NULL;
-        if (s->head_service->next)
-            s->head_service->next = NULL;
-    }
+void enqueue(sim_context *ctx, server *s, double arrival, double entry) {
+    job_handle h = alloc_job(&ctx->jobs);
 
-    s->tail = j;
+    get_job(&ctx->jobs, h)->arrival = arrival;
+    get_job(&ctx->jobs, h)->entry = entry;
+    push_job(&s->queue, h);
 }
 
-// Rimuove il job dalla coda del server specificato
-void dequeue(server *s) {
+// Rimuove il job dalla coda del server specificato e ritorna il suo istante di ingresso nel sistema
+double dequeue(sim_context *ctx, server *s) {
     if (s->block->type == GREEN_PASS)
-        return;
-
-    struct job *j = s->head_service;
-
-    if (!j->next)
-        s->tail = NULL;
+        return s->entry;
 
-    s->head_service = j->next;
-    free(j);
+    job_handle h = pop_job(&s->queue);
+    double entry = get_job(&ctx->jobs, h)->entry;
+    free_job(&ctx->jobs, h);
+    return entry;
 }
 
 // Ritorna il server con meno job in coda di uno specifico blocco
-server *findShorterServer(struct block b) {
+server *findShorterServer(sim_context *ctx, struct block b) {
     int block_type = b.type;
-    int active_servers = global_network_status.num_online_servers[block_type];
-    int init_server = Equilikely(0, global_network_status.num_online_servers[block_type] - 1);
-    server *shorterTail = &global_network_status.server_list[block_type][init_server];
+    int init_server = Equilikely(0, ctx->network.num_online_servers[block_type] - 1);
 
     // Nel blocco green pass non ci sono code, quindi bisogna trovare soltanto il server IDLE
     if (block_type == GREEN_PASS) {
-        for (int j = 0; j < active_servers; j++) {
-            if (global_network_status.server_list[block_type][j].status == IDLE) {
-                return &global_network_status.server_list[block_type][j];
-            }
-        }
-        return NULL;
+        return first_idle_server(&ctx->network, block_type);
     }
 
-    int i = init_server;
-    int n = 0;
-    while (true) {
-        if (n == active_servers)
-            break;
-
-        server s = global_network_status.server_list[block_type][i];
-        int a = shorterTail->jobInTotal;
-        if (s.jobInTotal < a) {
-            if (!s.need_resched) {
-                shorterTail = &global_network_status.server_list[block_type][i];
-            }
-        }
-        n++;
-        i = (i + 1) % active_servers;
-    }
-    return shorterTail;
+    // Il server di partenza casuale rompe i pareggi tra i server con meno job
+    return shortest_server(&ctx->network, block_type, init_server);
 }
 
 // Processa un arrivo dall'esterno verso il sistema
-void process_arrival() {
-    blocks[TEMPERATURE_CTRL].total_arrivals++;
+void process_arrival(sim_context *ctx) {
+    SelectState(&ctx->rng);
+    if (ctx->in_system == 0 && ctx->collect_sojourns && estimator == ESTIMATOR_REG) {
+        close_cycle(&ctx->cycles, &ctx->sojourns);  // Punto di rigenerazione: l'arrivo trova la rete vuota
+    }
+    ctx->in_system++;
+    ctx->blocks[TEMPERATURE_CTRL].total_arrivals++;
 
-    server *s = findShorterServer(blocks[TEMPERATURE_CTRL]);
+    server *s = findShorterServer(ctx, ctx->blocks[TEMPERATURE_CTRL]);
+    integrate_server(s, ctx->clock.current);
     s->jobInTotal++;
     s->arrivals++;
+    update_length_index(&ctx->network, s);
 
     // Se il server trovato non ha nessun job in servizio, può servire il job appena arrivato
     if (s->status == IDLE) {
         double serviceTime = getService(TEMPERATURE_CTRL, s->stream);
         compl c = {s, INFINITY};
-        c.value = clock.current + serviceTime;
+        c.value = ctx->clock.current + serviceTime;
         s->status = BUSY;
+        update_idle_index(&ctx->network, s);
         s->sum.service += serviceTime;
         s->sum.served++;
-        insertSorted(&global_sorted_completions, c);
-        enqueue(s, clock.arrival);
+        insertCompletion(&ctx->completions, c);
+        enqueue(ctx, s, ctx->clock.arrival, ctx->clock.arrival);
     } else {
-        enqueue(s, clock.arrival);
+        enqueue(ctx, s, ctx->clock.arrival, ctx->clock.arrival);
         s->jobInQueue++;
-        blocks[TEMPERATURE_CTRL].jobInQueue++;
+        ctx->blocks[TEMPERATURE_CTRL].jobInQueue++;
     }
 
-    clock.arrival = getArrival(clock.current);  // Genera prossimo arrivo
+    ctx->clock.arrival = getArrival(ctx, ctx->clock.current);  // Genera prossimo arrivo
 }
 
 // Processa un next-event di completamento
-void process_completion(compl c) {
+void process_completion(sim_context *ctx, compl c) {
+    SelectState(&ctx->rng);
     int block_type = c.server->block->type;
 
-    blocks[block_type].total_completions++;
+    integrate_server(c.server, ctx->clock.current);
+    if (block_type == GREEN_PASS) {
+        integrate_block(&ctx->blocks[GREEN_PASS], ctx->clock.current);
+    }
+    ctx->blocks[block_type].total_completions++;
     c.server->completions++;
     c.server->jobInTotal--;
 
-    blocks[block_type].jobInBlock--;
+    ctx->blocks[block_type].jobInBlock--;
 
     int destination;
     server *shorterServer;
 
-    dequeue(c.server);  // Toglie il job servito dal server e fa "avanzare" la lista collegata di job
-    deleteElement(&global_sorted_completions, c);
+    double entry = dequeue(ctx, c.server);  // Toglie il job servito dal server e fa "avanzare" la coda di job
 
     // Se nel server ci sono job in coda, devo generare il prossimo completamento per tale server.
     if (c.server->jobInQueue > 0) {
         c.server->jobInQueue--;
-        blocks[block_type].jobInQueue--;
+        ctx->blocks[block_type].jobInQueue--;
         double service_1 = getService(block_type, c.server->stream);
-        c.value = clock.current + service_1;
+        c.value = ctx->clock.current + service_1;
         c.server->sum.service += service_1;
         c.server->sum.served++;
-        insertSorted(&global_sorted_completions, c);
+        updateCompletion(&ctx->completions, c.server, c.value);
 
     } else {
+        deleteCompletion(&ctx->completions, c.server);
         c.server->status = IDLE;
+        update_idle_index(&ctx->network, c.server);
     }
 
     // Se un server è schedulato per la terminazione e non ha job in coda va offline
     if (c.server->need_resched && c.server->jobInQueue == 0) {
         c.server->online = OFFLINE;
-        c.server->time_online += (clock.current - c.server->last_online);
-        c.server->last_online = clock.current;
+        c.server->time_online += (ctx->clock.current - c.server->last_online);
+        c.server->last_online = ctx->clock.current;
         c.server->need_resched = false;
     }
+    update_length_index(&ctx->network, c.server);
 
     // Se il completamento avviene sul blocco GREEN PASS allora il job esce dal sistema
     if (block_type == GREEN_PASS) {
-        completed++;
+        ctx->completed++;
+        ctx->in_system--;
+        if (ctx->collect_sojourns) {
+            record_sojourn(&ctx->sojourns, ctx->clock.current - entry);
+        }
         return;
     }
 
     // Gestione blocco destinazione
     destination = getDestination(c.server->block->type);  // Trova la destinazione adatta per il job appena servito
     if (destination == EXIT) {
-        dropped++;
-        blocks[TEMPERATURE_CTRL].total_bypassed++;
+        ctx->dropped++;
+        ctx->in_system--;
+        ctx->blocks[TEMPERATURE_CTRL].total_bypassed++;
+        if (ctx->collect_sojourns) {
+            record_sojourn(&ctx->sojourns, ctx->clock.current - entry);
+        }
         return;
     }
     if (destination != GREEN_PASS) {
-        blocks[destination].total_arrivals++;
+        ctx->blocks[destination].total_arrivals++;
 
-        shorterServer = findShorterServer(blocks[destination]);
+        shorterServer = findShorterServer(ctx, ctx->blocks[destination]);
+        integrate_server(shorterServer, ctx->clock.current);
         shorterServer->arrivals++;
         shorterServer->jobInTotal++;
-        enqueue(shorterServer, c.value);  // Posiziono il job nella coda del blocco destinazione e gli imposto come tempo di arrivo quello di completamento
+        update_length_index(&ctx->network, shorterServer);
+        enqueue(ctx, shorterServer, c.value, entry);  // Posiziono il job nella coda del blocco destinazione e gli imposto come tempo di arrivo quello di completamento
 
         // Se il server trovato non ha nessuno in coda, generiamo un tempo di servizio
         if (shorterServer->status == IDLE) {
             compl c2 = {shorterServer, INFINITY};
             double service_2 = getService(destination, shorterServer->stream);
-            c2.value = clock.current + service_2;
-            insertSorted(&global_sorted_completions, c2);
+            c2.value = ctx->clock.current + service_2;
+            insertCompletion(&ctx->completions, c2);
             shorterServer->status = BUSY;
+            update_idle_index(&ctx->network, shorterServer);
             shorterServer->sum.service += service_2;
             shorterServer->sum.served++;
             return;
         } else {
             shorterServer->jobInQueue++;
-            blocks[destination].jobInQueue++;
+            ctx->blocks[destination].jobInQueue++;
             return;
         }
     }
 
     // Desination == GREEN_PASS. Se non ci sono serventi liberi il job esce dal sistema (loss system)
-    blocks[destination].total_arrivals++;
-    shorterServer = findShorterServer(blocks[destination]);
+    ctx->blocks[destination].total_arrivals++;
+    shorterServer = findShorterServer(ctx, ctx->blocks[destination]);
 
     if (shorterServer != NULL) {
+        integrate_server(shorterServer, ctx->clock.current);
+        integrate_block(&ctx->blocks[GREEN_PASS], ctx->clock.current);
         shorterServer->jobInTotal++;
         shorterServer->arrivals++;
-        blocks[destination].jobInBlock++;
+        update_length_index(&ctx->network, shorterServer);
+        ctx->blocks[destination].jobInBlock++;
+        shorterServer->entry = entry;
         compl c3 = {shorterServer, INFINITY};
         double service_3 = getService(destination, shorterServer->stream);
-        c3.value = clock.current + service_3;
-        insertSorted(&global_sorted_completions, c3);
+        c3.value = ctx->clock.current + service_3;
+        insertCompletion(&ctx->completions, c3);
         shorterServer->status = BUSY;
+        update_idle_index(&ctx->network, shorterServer);
         shorterServer->sum.service += service_3;
         shorterServer->sum.served++;
         return;
 
     } else {
-        completed++;
-        bypassed++;
-        blocks[GREEN_PASS].total_bypassed++;
+        ctx->completed++;
+        ctx->in_system--;
+        ctx->bypassed++;
+        ctx->blocks[GREEN_PASS].total_bypassed++;
+        if (ctx->collect_sojourns) {
+            record_sojourn(&ctx->sojourns, ctx->clock.current - entry);
+        }
         return;
     }
 }
 
 // Scrive i tempi di risposta a tempo finito su un file csv
-void write_rt_csv_finite() {
+void write_rt_csv_finite(sim_context *ctx) {
     FILE *csv;
-    char filename[100];
+    char filename[PATH_LENGTH + 64];
     for (int j = 0; j < 3; j++) {
-        snprintf(filename, 100, "results/finite/rt_finite_slot%d.csv", j);
+        snprintf(filename, sizeof(filename), "%s/finite/rt_finite_slot%d.csv", params.output_dir, j);
         csv = open_csv(filename);
 
-        for (int i = 0; i < NUM_REPETITIONS; i++) {
-            append_on_csv(csv, i, statistics[i][j], 0);
+        for (int i = 0; i < ctx->repetitions; i++) {
+            append_on_csv(csv, i, ctx->statistics[i][j], 0);
         }
         fclose(csv);
     }
 }
 
 // Stampa il costo e l'utilizzazione media ad orizzonte finito
-void print_results_finite() {
+void print_results_finite(sim_context *ctx) {
     double total = 0;
-    for (int i = 0; i < NUM_REPETITIONS; i++) {
-        total += repetitions_costs[i];
+    for (int i = 0; i < ctx->repetitions; i++) {
+        total += ctx->repetitions_costs[i];
     }
 
-    printf("\nTOTAL MEAN CONFIGURATION COST: %f\n", total / NUM_REPETITIONS);
+    printf("\nTOTAL MEAN CONFIGURATION COST: %f\n", total / ctx->repetitions);
     for (int s = 0; s < 3; s++) {
         printf("\nSlot #%d:", s);
         for (int j = 0; j < NUM_BLOCKS; j++) {
             printf("\nMean Utilization for block %s: ", stringFromEnum(j));
             double p = 0;
-            for (int i = 0; i < NUM_REPETITIONS; i++) {
-                p += global_means_p_fin[i][s][j];
+            for (int i = 0; i < ctx->repetitions; i++) {
+                p += ctx->global_means_p_fin[i][s][j];
             }
-            printf("%f", p / NUM_REPETITIONS);
+            printf("%f", p / ctx->repetitions);
         }
     }
 }
 
 // Scrive i tempi di risposta a tempo infinito su un file csv
-void write_rt_csv_infinite(int slot) {
-    char filename[100];
-    snprintf(filename, 100, "results/infinite/rt_infinite_slot_%d.csv", slot);
+void write_rt_csv_infinite(sim_context *ctx, int slot) {
+    char filename[PATH_LENGTH + 64];
+    snprintf(filename, sizeof(filename), "%s/infinite/rt_infinite_slot_%d.csv", params.output_dir, slot);
     FILE *csv;
     csv = open_csv(filename);
-    for (int j = 0; j < BATCH_K; j++) {
-        append_on_csv(csv, j, infinite_statistics[j], 0);
+    for (int j = 0; j < params.batch_k; j++) {
+        append_on_csv(csv, j, ctx->infinite_statistics[j], 0);
     }
     fclose(csv);
 }
 
 // Stampa il costo e l'utilizzazione media ad orizzonte finito per ogni singolo server
-void print_results_infinite(int slot) {
-    double cost = calculate_cost(&global_network_status);
+void print_results_infinite(sim_context *ctx, int slot) {
+    // Costo della configurazione per la durata dello slot: il tempo online dei server dipende dalla lunghezza della run
+    double cost = configuration_cost(ctx->config.slot_config[slot], params.time_slot[slot]);
     printf("\n\nTOTAL SLOT %d CONFIGURATION COST: %f\n", slot, cost);
 
     double l = 0;
     for (int j = 0; j < NUM_BLOCKS; j++) {
         printf("\nMean Utilization for block %s: ", stringFromEnum(j));
         double p = 0;
-        for (int i = 0; i < BATCH_K; i++) {
-            p += global_means_p[i][j];
+        for (int i = 0; i < params.batch_k; i++) {
+            p += ctx->global_means_p[i][j];
             if (j == GREEN_PASS) {
-                l += global_loss[i];
+                l += ctx->global_loss[i];
             }
         }
-        printf("%f", p / BATCH_K);
+        printf("%f", p / params.batch_k);
+    }
+    printf("\nGREEN PASS LOSS PERC %f: ", l / params.batch_k);
+    printf("\nBATCH SIZE: %d%s", ctx->batch_b, acc_autocorrelation(&ctx->batch_rt, 1) >= params.batch_acf ? " (run.batch_b_max reached, batch means still correlated)" : "");
+    printf("\nMEAN RESPONSE TIME: %f +/- %f (lag-1 autocorrelation %.3f)", ctx->batch_rt.mean, acc_half_width(&ctx->batch_rt), acc_autocorrelation(&ctx->batch_rt, 1));
+    if (delete_warm_up) {
+        printf("\nWARM-UP (MSER-%d): %ld jobs deleted, batches start at %f s%s", MSER_BATCH, ctx->warm_up_jobs, ctx->warm_up_time,
+               ctx->warm_up_short ? " (no steady state within the pilot run, increase MSER_PILOT)" : "");
+    }
+    if (estimator != ESTIMATOR_BM) {
+        print_sojourn_estimate(ctx);
+    }
+    printf("\nJOB POOL HIGH-WATER MARK: %ld jobs (%u slabs)\n", ctx->jobs.max_high_water, ctx->jobs.num_slabs);
+}
+
+// Controlla prima di simulare che con -e REG la rete dello slot, o di ciascuno dei tre slot, si svuoti abbastanza spesso.
+// In forma prodotto la rete è vuota con probabilità pari al prodotto delle probabilità di blocco vuoto e, per PASTA, questa è
+// anche la frazione di arrivi che apre un ciclo: sotto REG_MIN_CYCLES cicli attesi nella run più lunga il metodo rigenerativo
+// non produrrebbe una stima, quindi viene rifiutato
+bool check_regeneration(int num_slot) {
+    double visits[NUM_BLOCKS];
+    visit_ratios(visits);
+    long arrivals = (long)params.batch_b_max * params.batch_k;
+    for (int slot = 0; slot < 3; slot++) {
+        if (num_slot != ALL_SLOTS && slot != num_slot) {
+            continue;
+        }
+        double p0 = 1;
+        for (int j = 0; j < NUM_BLOCKS; j++) {
+            double a = params.lambda[slot] * visits[j] * params.service[j];
+            p0 *= empty_probability(params.staffing.slot_config[slot][j], a, j == GREEN_PASS);
+        }
+        if (p0 * arrivals < REG_MIN_CYCLES) {
+            printf("-e REG is not applicable to slot %d: the network is empty with probability %g, about %.1f regeneration cycles "
+                   "expected in %ld arrivals (at least %d needed)\n", slot, p0, p0 * arrivals, arrivals, REG_MIN_CYCLES);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Stampa l'intervallo di confidenza del tempo di risposta dei singoli job calcolato con lo stimatore scelto e, per confronto,
+// con le batch means sulla stessa serie. Le batch sono params.batch_k, come per le batch means della simulazione. Con REG la stima
+// viene dai cicli rigenerativi completi e non dipende né dalla dimensione delle batch né dal transitorio iniziale
+void print_sojourn_estimate(sim_context *ctx) {
+    long n = ctx->sojourns.count;
+    long m = n / params.batch_k;
+    if (estimator == ESTIMATOR_REG) {
+        if (ctx->cycles.cycles < 2) {
+            printf("\nJOB RESPONSE TIME (REG): %ld regeneration cycles, the network never empties", ctx->cycles.cycles);
+        } else {
+            double w;
+            double mean = ratio_estimate(&ctx->cycles, &w);
+            printf("\nJOB RESPONSE TIME (REG, %ld cycles, %.0f jobs, %.1f jobs per cycle): %f +/- %f", ctx->cycles.cycles,
+                   ctx->cycles.sum_n, ctx->cycles.sum_n / ctx->cycles.cycles, mean, w);
+        }
+    }
+    if (m < 2) {
+        return;
+    }
+    int shown[] = {estimator, ESTIMATOR_BM};
+    for (int i = estimator == ESTIMATOR_REG; i < 2; i++) {
+        double mean;
+        double dof;
+        double sigma2 = variance_parameter(ctx->sojourns.values, n, m, shown[i], &mean, &dof);
+        double w = confidence_half_width(sigma2 / (m * params.batch_k), (long)dof);
+        printf("\nJOB RESPONSE TIME (%s, %ld jobs, m = %ld): %f +/- %f", estimator_names[shown[i]], m * params.batch_k, m, mean, w);
     }
-    printf("\nGREEN PASS LOSS PERC %f: ", l / BATCH_K);
-    printf("\n");
+}
+
+// Svuota la serie dei tempi di risposta e ricomincia la ricerca del primo punto di rigenerazione
+void clear_sojourns(sim_context *ctx) {
+    ctx->sojourns.count = 0;
+    ctx->cycles = (regenerative_cycles){.start = -1};
+}
+
+// Stampa una tabella riassuntiva con costo, utilizzazione media per blocco e perdita del green pass dei tre slot
+void print_results_all(slot_pool *pool) {
+    print_line();
+    printf("%-20s%16s%16s%16s\n", "", "SLOT 0", "SLOT 1", "SLOT 2");
+    printf("%-20s", "COST");
+    for (int slot = 0; slot < 3; slot++) {
+        printf("%16f", configuration_cost(pool->contexts[slot]->config.slot_config[slot], params.time_slot[slot]));
+    }
+    for (int j = 0; j < NUM_BLOCKS; j++) {
+        printf("\n%-20s", stringFromEnum(j));
+        for (int slot = 0; slot < 3; slot++) {
+            double p = 0;
+            for (int i = 0; i < params.batch_k; i++) {
+                p += pool->contexts[slot]->global_means_p[i][j];
+            }
+            printf("%16f", p / params.batch_k);
+        }
+    }
+    if (delete_warm_up) {
+        printf("\n%-20s", "WARM-UP JOBS");
+        for (int slot = 0; slot < 3; slot++) {
+            printf("%16ld", pool->contexts[slot]->warm_up_jobs);
+        }
+    }
+    printf("\n%-20s", "BATCH SIZE");
+    for (int slot = 0; slot < 3; slot++) {
+        printf("%16d", pool->contexts[slot]->batch_b);
+    }
+    printf("\n%-20s", "GREEN PASS LOSS");
+    for (int slot = 0; slot < 3; slot++) {
+        double l = 0;
+        for (int i = 0; i < params.batch_k; i++) {
+            l += pool->contexts[slot]->global_loss[i];
+        }
+        printf("%16f", l / params.batch_k);
+    }
+    print_line();
 }
 
 // Resetta le statistiche tra un batch ed il successivo
-void reset_statistics() {
-    clock.batch_current = clock.current;
+void reset_statistics(sim_context *ctx) {
+    ctx->clock.batch_current = ctx->clock.current;
     for (int block_type = 0; block_type < NUM_BLOCKS; block_type++) {
-        blocks[block_type].total_arrivals = 0;
-        blocks[block_type].total_completions = 0;
-        blocks[block_type].total_bypassed = 0;
-        blocks[block_type].area.node = 0;
-        blocks[block_type].area.service = 0;
-        blocks[block_type].area.queue = 0;
+        ctx->blocks[block_type].total_arrivals = 0;
+        ctx->blocks[block_type].total_completions = 0;
+        ctx->blocks[block_type].total_bypassed = 0;
+        ctx->blocks[block_type].area.node = 0;
+        ctx->blocks[block_type].area.service = 0;
+        ctx->blocks[block_type].area.queue = 0;
+        ctx->blocks[block_type].last_change = ctx->clock.current;  // Il prossimo batch integra a partire da qui
         for (int j = 0; j < MAX_SERVERS; j++) {
-            server *s = &global_network_status.server_list[block_type][j];
+            server *s = &ctx->network.server_list[block_type][j];
             if (s->used) {
                 s->arrivals = 0;
                 s->completions = 0;
                 s->area.node = 0;
                 s->area.queue = 0;
                 s->area.service = 0;
+                s->last_change = ctx->clock.current;
             }
         }
     }
 }
 
-// Setta la configurazione di avvio specificata
-void init_config() {
+// Ritorna in config il piano dei serventi predefinito, sostituibile con la sezione [staffing] del file di configurazione
+void init_config(network_configuration *config) {
     int slot_null[] = {0, 0, 0, 0, 0};
 
     // Configurazione di testing
@@ -845,5 +1978,89 @@ void init_config() {
     int slot1_inf[] = {8, 20, 2, 10, 20};
     int slot2_inf[] = {4, 13, 2, 6, 10};
 
-    config = get_config(slot0_inf, slot1_inf, slot2_inf);
-}
\ No newline at end of file
+    *config = get_config(slot0_inf, slot1_inf, slot2_inf);
+}
+
+// Setta le configurazioni confrontate dalla modalità COMPARE (al massimo MAX_CONTENDERS) e ne ritorna il numero
+int init_candidates(network_configuration candidates[]) {
+    // Configurazioni ottime
+    int slot0_ottima[] = {8, 22, 2, 10, 11};
+    int slot1_ottima[] = {15, 44, 3, 18, 20};
+    int slot2_ottima[] = {7, 21, 2, 9, 10};
+
+    // Configurazioni ottime del sistema base
+    int slot0_ottima_orig[] = {8, 21, 2, 9, 11};
+    int slot1_ottima_orig[] = {14, 41, 3, 17, 20};
+    int slot2_ottima_orig[] = {8, 18, 2, 9, 10};
+
+    // Configurazione trovata dalla modalità SEARCH
+    int slot0_search[] = {8, 22, 3, 9, 10};
+    int slot1_search[] = {15, 39, 4, 16, 18};
+    int slot2_search[] = {8, 20, 4, 8, 9};
+
+    // Configurazione non ottima in termini di costo
+    int slot0_non_ottima[] = {12, 25, 4, 15, 20};
+    int slot1_non_ottima[] = {18, 46, 5, 20, 25};
+    int slot2_non_ottima[] = {10, 28, 5, 12, 15};
+
+    candidates[0] = get_config(slot0_ottima, slot1_ottima, slot2_ottima);
+    candidates[1] = get_config(slot0_ottima_orig, slot1_ottima_orig, slot2_ottima_orig);
+    candidates[2] = get_config(slot0_search, slot1_search, slot2_search);
+    candidates[3] = get_config(slot0_non_ottima, slot1_non_ottima, slot2_non_ottima);
+    return 4;
+}
+
+// Interrompe la simulazione se nella replica uno stream è andato oltre la propria fetta di PlantReplicationSeeds, o se è stato
+// usato uno stream che PlantReplicationSeeds non rende disgiunto: le repliche non sarebbero più indipendenti
+void check_overlap(sim_context *ctx, int repetition) {
+    unsigned long long draws;
+    int stream = ReplicationOverlap(&ctx->rng, &draws);
+    if (stream >= REPLICATION_STREAMS) {
+        printf("Replication %d used stream %d, which PlantReplicationSeeds does not plant\n", repetition, stream);
+        exit(EXIT_FAILURE);
+    }
+    if (stream >= 0) {
+        printf("Replication %d used %llu random numbers of stream %d, more than the %lu of its slice\n", repetition, draws, stream,
+               RNG_SUBSTREAM_JUMP);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Verifica che il pool delle repliche ad orizzonte finito accumuli per ogni slot e blocco un'utilizzazione
+// compresa tra 0 e 1, cioè che summary_finite.csv non riporti righe u_ nulle
+void test_utilization(void) {
+#define UTILIZATION_TEST_REPS 4
+    sim_context *ctx = create_context(params.seed_finite);
+    ctx->config = params.staffing;
+    replication_pool pool = {.results = ctx, .stop_time = stop_simulation, .repetitions = UTILIZATION_TEST_REPS, .stop_at = UTILIZATION_TEST_REPS};
+    pool.outputs = calloc(UTILIZATION_TEST_REPS, sizeof(replication_output));
+    if (pool.outputs == NULL) {
+        handle_error("calloc");
+    }
+    run_replication_pool(&pool);
+    printf("\n");
+
+    bool ok = pool.prefix == UTILIZATION_TEST_REPS;
+    printf("\n %-18s %10s %10s %10s\n", "", "slot 0", "slot 1", "slot 2");
+    for (int j = 0; j < NUM_BLOCKS; j++) {
+        printf(" %-18s", stringFromEnum(j));
+        for (int s = 0; s < 3; s++) {
+            accumulator *u = &pool.utilization[s][j];
+            printf(" %10.5f", u->mean);
+            ok = ok && u->n == UTILIZATION_TEST_REPS && u->min > 0 && u->max < 1;
+        }
+        printf("\n");
+    }
+    if (ok) {
+        printf("\n The finite horizon utilizations are within (0,1).\n\n");
+    } else {
+        printf("\n\a ERROR -- the finite horizon utilizations are not within (0,1).\n\n");
+    }
+
+    for (int r = 0; r < UTILIZATION_TEST_REPS; r++) {
+        free(pool.outputs[r].csv);
+    }
+    free(pool.outputs);
+    destroy_context(ctx);
+#undef UTILIZATION_TEST_REPS
+}
@@ -5,9 +5,30 @@ double min(double a, double b);
 int routing_from_temperature();
 void waitInput();
 void clearScreen();
-int binarySearch(sorted_completions *compls, int low, int high, compl completion);
-int insertSorted(sorted_completions *compls, compl completion);
-int deleteElement(sorted_completions *compls, compl completion);
+void update_idle_index(network_status *network, server *s);
+server *first_idle_server(network_status *network, int block);
+void integrate_server(server *s, double now);
+void integrate_block(struct block *b, double now);
+void flush_areas(network_status *network, struct block blocks[], double now);
+void update_length_index(network_status *network, server *s);
+server *shortest_server(network_status *network, int block, int start);
+void init_length_index(network_status *network, int block);
+struct job *get_job(job_pool *pool, job_handle h);
+job_handle alloc_job(job_pool *pool);
+void free_job(job_pool *pool, job_handle h);
+void reset_job_pool(job_pool *pool);
+void free_job_pool(job_pool *pool);
+void reserve_queue(job_queue *q, uint32_t n);
+void push_job(job_queue *q, job_handle h);
+job_handle pop_job(job_queue *q);
+void move_tail_jobs(job_queue *src, job_queue *dst, uint32_t n);
+void clear_queue(job_queue *q);
+void free_queue(job_queue *q);
+void initCompletions(sorted_completions *compls);
+int insertCompletion(sorted_completions *compls, compl completion);
+int deleteCompletion(sorted_completions *compls, server *s);
+void updateCompletion(sorted_completions *compls, server *s, double value);
+compl *getNextCompletion(sorted_completions *compls);
 void print_block_status(sorted_completions *server_list, struct block blocks[], int dropped, int completions, int bypassed);
 void print_statistics(network_status *network, struct block blocks[], double currentClock, sorted_completions *server_list);
 char *stringFromEnum(enum block_types f);
@@ -20,17 +41,47 @@ void calculate_statistics_fin(network_status *network, double currentClock, doub
 void calculate_statistics_inf(network_status *network, struct block blocks[], double currentClock, double rt_arr[], int pos);
 void calculate_statistics_clock(network_status *network, struct block blocks[], double currentClock, FILE *csv);
 void print_line();
+void acc_add(accumulator *a, double x);
+double acc_stdev(accumulator *a);
+double acc_half_width(accumulator *a);
+double acc_autocorrelation(accumulator *a, int j);
+FILE *open_summary(char *filename);
+void append_summary(FILE *fpt, char *metric, accumulator *a);
+void record_sojourn(sojourn_series *series, double value);
+double confidence_half_width(double variance, long dof);
+void close_cycle(regenerative_cycles *r, sojourn_series *series);
+double ratio_estimate(regenerative_cycles *r, double *half_width);
+long mser_truncation(double x[], long n, int m);
+double variance_parameter(double x[], long n, long m, int estimator, double *mean, double *dof);
 FILE *open_csv(char *filename);
 
 void *append_on_csv(FILE *fpt, int rep, double ts, double p);
 
 void print_real_cost(network_status *net);
 double calculate_cost(network_status *net);
+double seconds_in_month(void);
+double configuration_cost(int servers[], double duration);
+void stability_bound(double lambda, int bound[]);
+void visit_ratios(double visits[]);
+double erlang_b(int c, double a);
+double erlang_c(int c, double a);
+double population_total(int c, double a, bool loss);
+double empty_probability(int c, double a, bool loss);
+int stationary_population(int c, double a, bool loss, double u);
+void solve_analytic(network_configuration *config, int slot, analytic_network *out);
 void print_configuration(network_configuration *config);
 
 void printServerInfo(network_status network, int blockType);
 void print_single_server_info(server s);
 
 void print_job_list(struct job *j);
-void print_servers_statistics(network_status *network, double stop, double currentClock);
-void print_p_on_csv(network_status *network, double currentClock, int slot);
\ No newline at end of file
+void print_servers_statistics(network_status *network, double stop, double currentClock, FILE *out);
+void print_p_on_csv(network_status *network, double currentClock, int slot);
+
+extern model_parameters params;
+void default_parameters(model_parameters *p, network_configuration *staffing);
+bool set_parameter(model_parameters *p, char *name, char *value);
+void load_parameters(model_parameters *p, char *path);
+bool override_parameter(model_parameters *p, char *arg);
+bool check_parameters(model_parameters *p);
+void make_output_dirs(char *dir);